@@ -0,0 +1,242 @@
+// asyncdisk.cc 
+//	Routines to access the disk asynchronously.  The physical disk
+//	can only do one transfer at a time, so requests wait on a
+//	queue, and the disk interrupt handler starts the next transfer.
+//	The queue is shared with the interrupt handler, so we protect it
+//	by turning interrupts off rather than with a lock.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "asyncdisk.h"
+#include "synch.h"
+#include "main.h"
+
+DiskSchedType AsyncDisk::policy = DiskFCFS;
+
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Describe a disk transfer.  The caller fills in "done" and/or
+//	"callWhenDone" before submitting it, to hear about completion.
+//
+//	"sectorNumber"/"firstSector" -- the (first) sector to transfer
+//	"data" -- the buffer for a single sector
+//	"count" -- the number of consecutive sectors
+//	"buffers" -- a buffer for each of them; the array is copied
+//	"write" -- TRUE to write the disk, FALSE to read it
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sectorNumber, char *data, bool write)
+{
+    sector = sectorNumber;
+    numSectors = 1;
+    single = data;
+    this->data = &single;
+    writing = write;
+    done = NULL;
+    callWhenDone = NULL;
+    numDone = 0;
+}
+
+DiskRequest::DiskRequest(int firstSector, int count, char **buffers, bool write)
+{
+    ASSERT(count > 0 && firstSector + count <= NumSectors);
+    sector = firstSector;
+    numSectors = count;
+    data = new char *[count];
+    for (int i = 0; i < count; i++)
+	data[i] = buffers[i];
+    single = NULL;
+    writing = write;
+    done = NULL;
+    callWhenDone = NULL;
+    numDone = 0;
+}
+
+DiskRequest::~DiskRequest()
+{
+    if (data != &single)
+	delete [] data;
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::AsyncDisk
+// 	Initialize the asynchronous interface to the physical disk, in
+//	turn initializing the physical disk.
+//
+//	"name" -- UNIX file name to be used as storage for the disk data
+//----------------------------------------------------------------------
+
+AsyncDisk::AsyncDisk(char *name)
+{
+    queue = new List<DiskRequest *>;
+    current = NULL;
+    headTrack = 0;
+    sweepUp = TRUE;
+    transferBuffer = new char[SectorsPerTrack * SectorSize];
+    transferCount = 0;
+    disk = new Disk(name, this);
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::~AsyncDisk
+// 	De-allocate the asynchronous disk, closing the physical disk.
+//
+//	This happens when Nachos halts, and another thread may still be
+//	waiting for a request (some other program's page fault, say).
+//	That thread will never run again, so its request -- which it
+//	owns -- is just forgotten.
+//----------------------------------------------------------------------
+
+AsyncDisk::~AsyncDisk()
+{
+    delete disk;
+    delete queue;
+    delete [] transferBuffer;
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::Submit
+// 	Queue a disk request, and start it if the disk is idle.  Return
+//	without waiting for it.
+//----------------------------------------------------------------------
+
+void
+AsyncDisk::Submit(DiskRequest *request)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+
+    ASSERT(request->numDone == 0);
+    queue->Append(request);
+    if (current == NULL)
+	StartNext();
+    (void) kernel->interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::CallBack
+// 	Disk interrupt handler.  Go on to the next run of the current
+//	request; if it is complete, tell its owner, and start the next
+//	request.
+//----------------------------------------------------------------------
+
+void
+AsyncDisk::CallBack()
+{
+    DiskRequest *finished = current;
+
+    if (!finished->writing) {		// scatter what we read
+	for (int i = 0; i < transferCount; i++)
+	    bcopy(&transferBuffer[i * SectorSize], 
+			finished->data[finished->numDone + i], SectorSize);
+    }
+    finished->numDone += transferCount;
+    if (!finished->IsDone()) {
+	StartTransfer();
+	return;
+    }
+    StartNext();
+    if (finished->callWhenDone != NULL)
+	finished->callWhenDone->CallBack();
+    if (finished->done != NULL)
+	finished->done->V();
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::StartTransfer
+// 	Hand the disk the next run of the current request: as many of
+//	its remaining sectors as are on the same track.
+//----------------------------------------------------------------------
+
+void
+AsyncDisk::StartTransfer()
+{
+    int sectorNumber = current->sector + current->numDone;
+
+    transferCount = min(current->numSectors - current->numDone, 
+			SectorsPerTrack - sectorNumber % SectorsPerTrack);
+    headTrack = sectorNumber / SectorsPerTrack;
+    if (current->writing) {		// gather what we write
+	for (int i = 0; i < transferCount; i++)
+	    bcopy(current->data[current->numDone + i], 
+			&transferBuffer[i * SectorSize], SectorSize);
+	disk->WriteRequest(sectorNumber, transferBuffer, transferCount);
+    } else
+	disk->ReadRequest(sectorNumber, transferBuffer, transferCount);
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::StartNext
+// 	The disk is idle: start the next queued request, if any.
+//	Called with interrupts off.
+//----------------------------------------------------------------------
+
+void
+AsyncDisk::StartNext()
+{
+    ASSERT(kernel->interrupt->getLevel() == IntOff);
+    if (queue->IsEmpty()) {
+	current = NULL;
+	return;
+    }
+    current = ChooseNext();
+    StartTransfer();
+}
+
+//----------------------------------------------------------------------
+// AsyncDisk::ChooseNext
+// 	Remove and return the queued request to serve next.
+//
+//	SSTF takes the request the disk can reach soonest, counting
+//	rotation as well as seeking (Disk::ComputeLatency).  SCAN and
+//	C-LOOK move the head across the tracks in one direction, taking
+//	requests on the way (nearest in time first, within a track).
+//	When no request is left ahead of the head, SCAN turns around,
+//	while C-LOOK goes back to the lowest track and sweeps up again.
+//----------------------------------------------------------------------
+
+DiskRequest *
+AsyncDisk::ChooseNext()
+{
+    DiskRequest *best = NULL;
+    int bestTrack = 0, bestTime = 0;
+    int track, time;
+    bool ahead;
+
+    if (policy == DiskFCFS)
+	return queue->RemoveFront();
+
+    for (int pass = 0; pass < 2 && best == NULL; pass++) {
+	ListIterator<DiskRequest *> it(queue);
+	for (; !it.IsDone(); it.Next()) {
+	    track = it.Item()->sector / SectorsPerTrack;
+	    time = disk->ComputeLatency(it.Item()->sector, it.Item()->writing);
+	    if (policy != DiskSSTF) {
+		// only requests in the direction of the sweep
+		ahead = sweepUp ? (track >= headTrack) : (track <= headTrack);
+		if (!ahead)
+		    continue;
+	    }
+	    if (best == NULL 
+		|| (policy == DiskSSTF && time < bestTime)
+		|| (policy != DiskSSTF && (abs(track - headTrack) 
+			< abs(bestTrack - headTrack) || 
+			(track == bestTrack && time < bestTime)))) {
+		best = it.Item();
+		bestTrack = track;
+		bestTime = time;
+	    }
+	}
+	if (best == NULL) {		// nothing left in this direction
+	    if (policy == DiskSCAN)
+		sweepUp = !sweepUp;
+	    else
+		headTrack = 0;		// C-LOOK: back to the start
+	}
+    }
+    ASSERT(best != NULL);
+    queue->Remove(best);
+    return best;
+}
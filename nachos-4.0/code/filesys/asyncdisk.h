@@ -0,0 +1,106 @@
+// asyncdisk.h 
+//	Data structures to export an asynchronous, queued interface to
+//	the raw disk device.
+//
+//	A kernel thread describes a transfer with a DiskRequest, submits
+//	it, and goes on with its work.  When the transfer is done, the
+//	disk interrupt handler notifies it, through a semaphore, a
+//	callback, or both.  This lets a thread have several transfers
+//	in flight at once (readahead, write-behind), or overlap its
+//	computation with the disk.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ASYNCDISK_H
+#define ASYNCDISK_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "callback.h"
+#include "list.h"
+
+// Disk scheduling policies: which queued request the disk serves next.
+
+enum DiskSchedType {
+    DiskFCFS,		// first come, first served
+    DiskSSTF,		// shortest (positioning) time first
+    DiskSCAN,		// elevator: sweep up, then down, and so on
+    DiskCLOOK		// sweep up only, then jump back to the lowest
+};
+
+class Semaphore;
+
+// The following class describes one disk transfer: "numSectors"
+// consecutive sectors starting at "sector".  Each sector has its own
+// memory buffer (scatter/gather), so a request can fill or drain
+// buffers that are not next to each other, such as cache buffers or
+// page frames.
+//
+// The request belongs to the thread that submits it, and must not be
+// touched (or deleted) until it is done.
+
+class DiskRequest {
+  public:
+    DiskRequest(int sectorNumber, char *data, bool write);
+					// A single sector request
+    DiskRequest(int firstSector, int count, char **buffers, bool write);
+					// A scatter/gather request
+    ~DiskRequest();
+
+    int sector;				// first sector to transfer
+    int numSectors;			// how many sectors
+    char **data;			// buffer for each sector
+    bool writing;			// write, rather than read?
+
+    Semaphore *done;			// if not NULL, V()'ed when done
+    CallBackObj *callWhenDone;		// if not NULL, called when done, 
+					// at interrupt level: it must not
+					// block
+
+    bool IsDone() { return numDone == numSectors; }
+
+  private:
+    int numDone;			// sectors transferred so far
+    char *single;			// "data" of a single sector request
+
+    friend class AsyncDisk;
+};
+
+// The following class defines the asynchronous disk.  Requests that
+// arrive while the disk is busy wait on a queue; each time the disk
+// finishes a request, "policy" picks the next one to start.  The
+// sectors of one request are transferred back to back, as few disk
+// operations as possible: one per track the request touches.
+
+class AsyncDisk : public CallBackObj {
+  public:
+    AsyncDisk(char *name);		// Initialize the raw Disk
+    ~AsyncDisk();			// All requests must be done by now
+
+    void Submit(DiskRequest *request);	// Queue a request and return
+					// right away
+
+    void CallBack();			// Called by the disk device interrupt
+					// handler when a transfer is done
+
+    static DiskSchedType policy;	// How to order queued requests
+
+  private:
+    Disk *disk;				// Raw disk device
+    List<DiskRequest *> *queue;		// Requests waiting for the disk
+    DiskRequest *current;		// Request the disk is serving, or NULL
+    int headTrack;			// Track of the last transfer started
+    bool sweepUp;			// Direction of the SCAN sweep
+    char *transferBuffer;		// One track's worth of sectors, to
+					// gather/scatter the request buffers
+    int transferCount;			// Sectors in the transfer under way
+
+    void StartTransfer();		// Start the next run of "current"
+    void StartNext();			// Start the next queued request
+    DiskRequest *ChooseNext();		// Take the next request off the
+					// queue, according to "policy"
+};
+
+#endif // ASYNCDISK_H
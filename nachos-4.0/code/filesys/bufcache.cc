@@ -0,0 +1,514 @@
+// bufcache.cc 
+//	Routines to manage the buffer cache of disk sectors.
+//
+//	The cache is a fixed array of buffers, threaded on a list in
+//	order of use: every hit moves its buffer to the back of the
+//	list, so the buffer at the front is the one to replace.
+//
+//	A lock protects the state of the buffers, but it isn't held
+//	across disk I/O.  A thread that reads a sector in, or writes one
+//	back, marks the buffer busy and lets go of the lock; anyone else
+//	who wants that buffer waits for it on "transferDone", and then
+//	looks again, since the buffer may have been given to another
+//	sector in the meantime.
+//
+//	Prefetch and WriteBehind gather runs of consecutive sectors 
+//	into one request to the AsyncDisk, and return right away.  The
+//	request is remembered in each of its buffers; the first thread
+//	to need one of them waits for the request and retires it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "bufcache.h"
+#include "synchdisk.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// BufferCache::BufferCache
+// 	Initialize an empty cache of disk sectors.
+//
+//	"disk" -- the disk whose sectors we cache
+//	"size" -- how many sectors to cache; 0 turns the cache off
+//----------------------------------------------------------------------
+
+BufferCache::BufferCache(SynchDisk *disk, int size)
+{
+    synchDisk = disk;
+    numBuffers = size;
+    buffers = new CacheBuffer[numBuffers];
+    lruList = new List<CacheBuffer *>;
+    for (int i = 0; i < numBuffers; i++) {
+	buffers[i].sector = -1;
+	buffers[i].dirty = FALSE;
+	buffers[i].pending = NULL;
+	buffers[i].busy = FALSE;
+	buffers[i].pinned = FALSE;
+	lruList->Append(&buffers[i]);
+    }
+    lock = new Lock("buffer cache lock");
+    waiting = new List<DiskRequest *>;
+    transferDone = new Condition("buffer cache transfer done");
+}
+
+//----------------------------------------------------------------------
+// BufferCache::~BufferCache
+// 	Write back anything still dirty, and de-allocate the cache.
+//----------------------------------------------------------------------
+
+BufferCache::~BufferCache()
+{
+    Flush();
+    delete transferDone;
+    delete waiting;
+    delete lock;
+    delete lruList;
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadSector
+// 	Read the contents of a disk sector into a buffer, from the
+//	cache if we have it, otherwise from disk (keeping a copy).
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadSector(int sectorNumber, char *data)
+{
+    ReadPartial(sectorNumber, data, 0, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteSector
+// 	Write the contents of a buffer into a disk sector.  Only the
+//	cached copy is updated; the disk is written later.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteSector(int sectorNumber, char *data)
+{
+    WritePartial(sectorNumber, data, 0, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadPartial
+// 	Read part of a disk sector, copying it straight from the cached
+//	copy of the sector into the caller's buffer.
+//
+//	"sectorNumber" -- the disk sector to read
+//	"into" -- where to put the bytes
+//	"offset" -- where in the sector the bytes start
+//	"numBytes" -- how many bytes to read
+//----------------------------------------------------------------------
+
+void
+BufferCache::ReadPartial(int sectorNumber, char *into, int offset, int numBytes)
+{
+    CacheBuffer *buf;
+    char data[SectorSize];
+
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    if (numBuffers == 0) {
+	if (numBytes == SectorSize)
+	    synchDisk->ReadSector(sectorNumber, into);
+	else {
+	    synchDisk->ReadSector(sectorNumber, data);
+	    bcopy(&data[offset], into, numBytes);
+	}
+	return;
+    }
+    lock->Acquire();
+    buf = Get(sectorNumber, TRUE);
+    bcopy(&buf->data[offset], into, numBytes);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WritePartial
+// 	Write part of a disk sector.  Only the cached copy is updated;
+//	if it isn't cached, and not all of it is being written, the rest
+//	of the sector has to be read in first.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"from" -- the new bytes
+//	"offset" -- where in the sector they go
+//	"numBytes" -- how many bytes to write
+//----------------------------------------------------------------------
+
+void
+BufferCache::WritePartial(int sectorNumber, char *from, int offset, int numBytes)
+{
+    CacheBuffer *buf;
+    char data[SectorSize];
+
+    ASSERT(offset >= 0 && numBytes >= 0 && offset + numBytes <= SectorSize);
+    if (numBuffers == 0) {
+	if (numBytes == SectorSize)
+	    synchDisk->WriteSector(sectorNumber, from);
+	else {
+	    synchDisk->ReadSector(sectorNumber, data);
+	    bcopy(from, &data[offset], numBytes);
+	    synchDisk->WriteSector(sectorNumber, data);
+	}
+	return;
+    }
+    lock->Acquire();
+    buf = Get(sectorNumber, numBytes < SectorSize);	// a whole sector
+							// needn't be read
+    bcopy(from, &buf->data[offset], numBytes);
+    buf->dirty = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flush
+// 	Write every dirty sector in the cache back to disk, and wait
+//	for any transfers still in flight.  The sectors stay cached.
+//	Pinned sectors are left for the journal to write.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Flush()
+{
+    lock->Acquire();
+    for (int i = 0; i < numBuffers; i++) {
+	Complete(&buffers[i]);
+	if (buffers[i].dirty && !buffers[i].pinned)
+	    WriteOut(&buffers[i]);
+    }
+    lock->Release();
+    DEBUG(dbgFile, "Buffer cache flushed.");
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Pin
+// 	Bring a sector into the cache, if it isn't there, and keep it
+//	there, never writing it to disk, until it is unpinned.  The 
+//	journal pins a sector before it is changed, so that the change
+//	reaches the disk no sooner than the journal says.
+//
+//	"sectorNumber" -- the sector to pin
+//----------------------------------------------------------------------
+
+void
+BufferCache::Pin(int sectorNumber)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    buf = Get(sectorNumber, TRUE);
+    buf->pinned = TRUE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unpin
+// 	The journal has written a pinned sector to disk, so the cached
+//	copy is clean, and the buffer can be replaced again.
+//
+//	"sectorNumber" -- the sector to unpin
+//----------------------------------------------------------------------
+
+void
+BufferCache::Unpin(int sectorNumber)
+{
+    CacheBuffer *buf;
+
+    lock->Acquire();
+    buf = Lookup(sectorNumber);
+    ASSERT(buf != NULL && buf->pinned);
+    buf->pinned = FALSE;
+    buf->dirty = FALSE;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Prefetch
+// 	Start reading in the sectors from "firstSector" to 
+//	"firstSector + count - 1" that aren't in the cache, without 
+//	waiting for them.  Each run of missing sectors is one disk
+//	request.  We never take more than half the cache, so that a
+//	big prefetch doesn't push out everything else, and we stop at
+//	the first sector that would mean waiting for a buffer.
+//
+//	"firstSector" -- the first sector to read
+//	"count" -- how many sectors
+//----------------------------------------------------------------------
+
+void
+BufferCache::Prefetch(int firstSector, int count)
+{
+    CacheBuffer **run, *buf;
+    int runLength = 0, i;
+
+    count = min(count, numBuffers / 2);
+    if (count <= 0 || synchDisk->logDisk != NULL)
+	return;				// a log's sectors are scattered
+    run = new CacheBuffer *[count];
+    lock->Acquire();
+    for (i = 0; i < count; i++) {
+	if (Lookup(firstSector + i) != NULL) {	// already here: the run
+	    Start(firstSector + i - runLength, runLength, run, FALSE);
+	    runLength = 0;			// stops short of it
+	} else if ((buf = Replace(firstSector + i, FALSE)) != NULL) {
+	    run[runLength++] = buf;
+	    kernel->stats->numCachePrefetches++;
+	} else
+	    break;				// no buffer free right now
+    }
+    Start(firstSector + i - runLength, runLength, run, FALSE);
+    lock->Release();
+    delete [] run;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteBehind
+// 	Start writing out the dirty cached sectors from "firstSector" to
+//	"firstSector + count - 1", without waiting for them.  Each run of
+//	them is one disk request.  The buffers count as clean from now 
+//	on; if they are written again before the disk gets to them, they
+//	just become dirty again.
+//
+//	"firstSector" -- the first sector to write
+//	"count" -- how many sectors
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteBehind(int firstSector, int count)
+{
+    CacheBuffer **run, *buf;
+    int runLength = 0;
+
+    if (numBuffers == 0 || count <= 0 || synchDisk->logDisk != NULL)
+	return;				// a log gathers writes itself
+    run = new CacheBuffer *[count];
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+	buf = Lookup(firstSector + i);
+	if (buf == NULL || !buf->dirty || buf->pending != NULL || 
+					buf->busy || buf->pinned) {
+	    Start(firstSector + i - runLength, runLength, run, TRUE);
+	    runLength = 0;
+	} else {
+	    buf->dirty = FALSE;
+	    run[runLength++] = buf;
+	    kernel->stats->numCacheWriteBacks++;
+	}
+    }
+    Start(firstSector + count - runLength, runLength, run, TRUE);
+    lock->Release();
+    delete [] run;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Start
+// 	Submit a request to transfer "count" buffers, holding the
+//	consecutive sectors from "firstSector" on, and mark them pending.
+//	The caller holds the lock.
+//
+//	"write" -- TRUE to write the buffers out, FALSE to read them in
+//----------------------------------------------------------------------
+
+void
+BufferCache::Start(int firstSector, int count, CacheBuffer **bufs, bool write)
+{
+    DiskRequest *request;
+    char **data;
+
+    if (count == 0)
+	return;
+    DEBUG(dbgFile, "Buffer cache " << (write ? "writing " : "reading ") 
+		<< count << " sectors from " << firstSector << " ahead");
+    data = new char *[count];
+    for (int i = 0; i < count; i++)
+	data[i] = bufs[i]->data;
+    request = new DiskRequest(firstSector, count, data, write);
+    request->done = new Semaphore("buffer cache transfer", 0);
+    for (int i = 0; i < count; i++)
+	bufs[i]->pending = request;
+    synchDisk->asyncDisk->Submit(request);
+    delete [] data;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Complete
+// 	Wait until nobody is reading "buf" in or writing it back.  If 
+//	a transfer started by Prefetch or WriteBehind is in flight, the
+//	first thread to need it waits for the disk, and retires it; 
+//	the others wait for that thread.  The caller holds the lock,
+//	but it is let go of while we wait, so "buf" may hold another
+//	sector by the time we return.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Complete(CacheBuffer *buf)
+{
+    DiskRequest *request;
+
+    for (;;) {
+	request = buf->pending;
+	if (buf->busy || (request != NULL && waiting->IsInList(request)))
+	    transferDone->Wait(lock);
+	else if (request != NULL) {
+	    waiting->Append(request);
+	    lock->Release();
+	    request->done->P();
+	    lock->Acquire();
+	    waiting->Remove(request);
+	    Retire(request);
+	    transferDone->Broadcast(lock);
+	} else
+	    return;
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Retire
+// 	A transfer started by Prefetch or WriteBehind has finished: none
+//	of its buffers is pending any more.  The caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+BufferCache::Retire(DiskRequest *request)
+{
+    for (int i = 0; i < numBuffers; i++) {
+	if (buffers[i].pending == request)
+	    buffers[i].pending = NULL;
+    }
+    delete request->done;
+    delete request;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Get
+// 	Return the buffer holding "sectorNumber", idle, making room for
+//	it if it isn't cached.  The caller holds the lock; it is let go
+//	of while the sector is read in, or while a buffer it has to wait
+//	for is busy, and every time it is we look again.
+//
+//	"sectorNumber" -- the sector wanted
+//	"fill" -- read in the sector, if it isn't cached? (not needed if
+//		the caller is about to overwrite all of it)
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Get(int sectorNumber, bool fill)
+{
+    CacheBuffer *buf;
+
+    for (;;) {
+	buf = Lookup(sectorNumber);
+	if (buf != NULL) {
+	    Complete(buf);		// it may still be on its way in
+	    if (buf->sector == sectorNumber) {
+		kernel->stats->numCacheHits++;
+		return buf;
+	    }
+	} else if ((buf = Replace(sectorNumber, TRUE)) != NULL) {
+	    kernel->stats->numCacheMisses++;
+	    if (!fill)
+		return buf;
+	    buf->busy = TRUE;
+	    lock->Release();
+	    synchDisk->ReadSector(sectorNumber, buf->data);
+	    lock->Acquire();
+	    buf->busy = FALSE;
+	    transferDone->Broadcast(lock);
+	    return buf;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// BufferCache::WriteOut
+// 	Write a dirty buffer back to disk, letting go of the lock while
+//	we wait.  The buffer counts as clean from the start: if it is
+//	written again while busy, it just becomes dirty again.  The
+//	caller holds the lock.
+//----------------------------------------------------------------------
+
+void
+BufferCache::WriteOut(CacheBuffer *buf)
+{
+    DEBUG(dbgFile, "Buffer cache writing back sector " << buf->sector);
+    buf->busy = TRUE;
+    buf->dirty = FALSE;
+    lock->Release();
+    synchDisk->WriteSector(buf->sector, buf->data);
+    lock->Acquire();
+    buf->busy = FALSE;
+    transferDone->Broadcast(lock);
+    kernel->stats->numCacheWriteBacks++;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Lookup
+// 	Return the buffer holding "sectorNumber", or NULL if it isn't
+//	cached.  A buffer that is found becomes the most recently used.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Lookup(int sectorNumber)
+{
+    for (int i = 0; i < numBuffers; i++) {
+	if (buffers[i].sector == sectorNumber) {
+	    lruList->Remove(&buffers[i]);
+	    lruList->Append(&buffers[i]);
+	    return &buffers[i];
+	}
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Replace
+// 	Give the least recently used buffer that isn't pinned to
+//	"sectorNumber"; the caller fills in the contents.  
+//
+//	If that buffer is dirty, or in use, it can't be had without 
+//	letting go of the lock -- to write it back, or to wait for it.
+//	We do so (if "canWait"), but then return NULL: another thread
+//	may have brought in "sectorNumber" meanwhile, so the caller has
+//	to look again.  A caller that can't wait gets the least recently
+//	used buffer that is free right now, or NULL if there isn't one.
+//----------------------------------------------------------------------
+
+CacheBuffer *
+BufferCache::Replace(int sectorNumber, bool canWait)
+{
+    ListIterator<CacheBuffer *> iter(lruList);
+    CacheBuffer *buf = NULL;
+
+    for (; !iter.IsDone() && buf == NULL; iter.Next()) {
+	if (iter.Item()->pinned)
+	    continue;
+	if (canWait || (!iter.Item()->dirty && !iter.Item()->busy &&
+					iter.Item()->pending == NULL))
+	    buf = iter.Item();
+    }
+    if (buf == NULL) {
+	ASSERT(!canWait);		// the journal pins at most half
+	return NULL;
+    }
+    if (buf->busy || buf->pending != NULL) {
+	Complete(buf);
+	return NULL;
+    }
+    if (buf->dirty) {
+	WriteOut(buf);
+	return NULL;
+    }
+    buf->sector = sectorNumber;
+    lruList->Remove(buf);
+    lruList->Append(buf);
+    return buf;
+}
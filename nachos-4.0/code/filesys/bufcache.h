@@ -0,0 +1,120 @@
+// bufcache.h 
+//	Data structures for a cache of disk sectors, kept in memory in
+//	front of the synchronous disk.
+//
+//	All file system reads and writes of disk sectors go through the
+//	cache.  A read that hits in the cache doesn't touch the disk at
+//	all; a write just updates the cached copy and marks it dirty.
+//	Dirty sectors are written to disk when their buffer is reused
+//	(we replace the least recently used buffer), or when the whole
+//	cache is flushed, as on Halt.
+//
+//	Sectors can also be read in before anyone asks for them
+//	(Prefetch), or written out before their buffer is needed
+//	(WriteBehind), without waiting for the disk.  A buffer with such
+//	a transfer in flight is "pending"; anyone who wants it waits 
+//	for the transfer to finish.
+//
+//	Threads only wait for one another when they want the same
+//	sector: the cache isn't locked while a buffer is being read in
+//	or written back, so misses on different sectors (say, for 
+//	different files) are all with the disk at once.
+//
+//	The journal (cf. journal.h) pins the sectors it logs: a pinned
+//	sector isn't written to disk, nor replaced, until the journal
+//	unpins it.
+//
+//	On a log-structured disk (cf. logdisk.h) there is no prefetching
+//	or write-behind: consecutive sectors aren't consecutive on disk,
+//	and the log gathers writes into whole tracks by itself.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BUFCACHE_H
+#define BUFCACHE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "list.h"
+
+#define DefaultCacheSize	64	// buffers, unless "-bc" says otherwise
+
+class SynchDisk;
+class Lock;
+class Condition;
+class DiskRequest;
+
+// One cached disk sector.
+
+class CacheBuffer {
+  public:
+    int sector;				// which sector is cached here, or
+					// -1 if the buffer is unused
+    bool dirty;				// modified since read from disk?
+    DiskRequest *pending;		// transfer in flight, or NULL
+    bool busy;				// being read in or written back by
+					// a thread that let go of the lock
+    bool pinned;			// held for the journal?
+    char data[SectorSize];		// the contents of the sector
+};
+
+// The following class defines the buffer cache.  It has the same
+// interface as SynchDisk, so the file system uses it in its place.
+// A cache with no buffers passes every request straight to the disk.
+
+class BufferCache {
+  public:
+    BufferCache(SynchDisk *disk, int size);
+					// Cache "size" sectors of "disk"
+    ~BufferCache();			// Flush, then de-allocate the cache
+
+    void ReadSector(int sectorNumber, char *data);
+					// Read a sector, from the cache if
+					// it is there
+    void WriteSector(int sectorNumber, char *data);
+					// Write a sector into the cache
+    void ReadPartial(int sectorNumber, char *into, int offset, int numBytes);
+    void WritePartial(int sectorNumber, char *from, int offset, int numBytes);
+					// Read/write part of a sector
+    void Flush();			// Write all dirty sectors to disk,
+					// except pinned ones
+
+    void Pin(int sectorNumber);		// Keep a sector in the cache, and
+					// off the disk
+    void Unpin(int sectorNumber);	// The journal has written it home
+
+    void Prefetch(int firstSector, int count);
+					// Start reading in whichever of
+					// "count" sectors aren't cached
+    void WriteBehind(int firstSector, int count);
+					// Start writing out whichever of
+					// them are dirty
+
+  private:
+    SynchDisk *synchDisk;		// where the sectors really live
+    int numBuffers;			// size of the cache
+    CacheBuffer *buffers;		// the buffers themselves
+    List<CacheBuffer *> *lruList;	// buffers in order of use, least 
+					// recently used at the front
+    Lock *lock;				// protects the buffers' state
+    List<DiskRequest *> *waiting;	// pending transfers someone is
+					// already waiting for
+    Condition *transferDone;		// signalled when a buffer stops
+					// being busy or pending
+
+    CacheBuffer *Get(int sectorNumber, bool fill);
+					// Find or make a buffer for a sector
+    CacheBuffer *Lookup(int sectorNumber);
+					// Find a sector in the cache
+    CacheBuffer *Replace(int sectorNumber, bool canWait);
+					// Make room for a sector in the cache
+    void WriteOut(CacheBuffer *buf);	// Write a dirty buffer back
+    void Complete(CacheBuffer *buf);	// Wait until a buffer is idle
+    void Retire(DiskRequest *request);	// A pending transfer is done
+    void Start(int firstSector, int count, CacheBuffer **bufs, bool write);
+					// Start a transfer of buffers
+};
+
+#endif // BUFCACHE_H
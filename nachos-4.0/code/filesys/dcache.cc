@@ -0,0 +1,156 @@
+// dcache.cc 
+//	Routines to manage the cache of directory lookups.
+//
+//	Entries are hashed on the directory and the name together, so
+//	that the same name in different directories lands in different
+//	buckets.  A bucket is a List of entries; buckets are short, 
+//	so they are just searched from front to back.
+//
+//	Lookups from many threads at once (cf. filesys.cc) share the
+//	cache, so a lock makes each request atomic.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dcache.h"
+#include "synch.h"
+#include "main.h"
+#include <string.h>
+
+//----------------------------------------------------------------------
+// DirCache::DirCache
+// 	Initialize an empty lookup cache.
+//----------------------------------------------------------------------
+
+DirCache::DirCache()
+{
+    for (int i = 0; i < DirCacheBuckets; i++)
+	buckets[i] = new List<DirCacheEntry *>;
+    lock = new Lock("dir cache");
+}
+
+//----------------------------------------------------------------------
+// DirCache::~DirCache
+// 	De-allocate the cache, and every entry in it.
+//----------------------------------------------------------------------
+
+DirCache::~DirCache()
+{
+    for (int i = 0; i < DirCacheBuckets; i++) {
+	while (!buckets[i]->IsEmpty())
+	    delete buckets[i]->RemoveFront();
+	delete buckets[i];
+    }
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Bucket
+// 	Return the bucket holding the lookup of "name" in "parent".
+//----------------------------------------------------------------------
+
+List<DirCacheEntry *> *
+DirCache::Bucket(int parent, char *name)
+{
+    unsigned int hash = parent;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 33 + (unsigned char) name[i];
+    return buckets[hash % DirCacheBuckets];
+}
+
+//----------------------------------------------------------------------
+// DirCache::FindEntry
+// 	Return the cache entry for "name" in "parent", or NULL if there
+//	is none.
+//----------------------------------------------------------------------
+
+DirCacheEntry *
+DirCache::FindEntry(int parent, char *name)
+{
+    ListIterator<DirCacheEntry *> iter(Bucket(parent, name));
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->parent == parent 
+		&& !strncmp(iter.Item()->name, name, FileNameMaxLen))
+	    return iter.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Lookup
+// 	Return TRUE if the lookup of "name" in the directory with its
+//	header in sector "parent" is cached, and if so where the header
+//	of "name" is, and whether it is a directory.
+//
+//	"parent" -- header sector of the directory to look in
+//	"name" -- the name to look up
+//	"sector", "isDir" -- where to return the result
+//----------------------------------------------------------------------
+
+bool
+DirCache::Lookup(int parent, char *name, int *sector, bool *isDir)
+{
+    DirCacheEntry *entry;
+
+    lock->Acquire();
+    entry = FindEntry(parent, name);
+    if (entry == NULL) {
+	kernel->stats->numDirCacheMisses++;
+	lock->Release();
+	return FALSE;
+    }
+    kernel->stats->numDirCacheHits++;
+    *sector = entry->sector;
+    *isDir = entry->isDir;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DirCache::Enter
+// 	Remember that "name" in directory "parent" has its header in
+//	"sector".
+//----------------------------------------------------------------------
+
+void
+DirCache::Enter(int parent, char *name, int sector, bool isDir)
+{
+    DirCacheEntry *entry;
+
+    lock->Acquire();
+    entry = FindEntry(parent, name);
+    if (entry == NULL) {
+	entry = new DirCacheEntry;
+	entry->parent = parent;
+	strncpy(entry->name, name, FileNameMaxLen);
+	entry->name[FileNameMaxLen] = '\0';
+	Bucket(parent, name)->Append(entry);
+    }
+    entry->sector = sector;
+    entry->isDir = isDir;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// DirCache::Forget
+// 	Drop the lookup of "name" in "parent", if it is cached; the 
+//	name has been removed from the directory.
+//----------------------------------------------------------------------
+
+void
+DirCache::Forget(int parent, char *name)
+{
+    DirCacheEntry *entry;
+
+    lock->Acquire();
+    entry = FindEntry(parent, name);
+    if (entry != NULL) {
+	Bucket(parent, name)->Remove(entry);
+	delete entry;
+    }
+    lock->Release();
+}
@@ -0,0 +1,61 @@
+// dcache.h 
+//	Data structures for a cache of directory lookups.
+//
+//	Resolving a path name means looking up each of its components
+//	in turn, each in the directory named by the one before.  The
+//	cache remembers the result of each such lookup -- which file
+//	header a name in a given directory leads to -- so that paths 
+//	used again don't have to be walked through the directories on 
+//	disk.  Only names that exist are cached; the file system tells
+//	the cache when a name goes away.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "copyright.h"
+#include "directory.h"
+#include "list.h"
+
+#define DirCacheBuckets		64	// hash buckets in the cache
+
+class Lock;
+
+// One cached lookup: "name" in the directory whose header is in
+// sector "parent" has its header in sector "sector".
+
+class DirCacheEntry {
+  public:
+    int parent;				// header sector of the directory
+    char name[FileNameMaxLen + 1];	// name looked up in it
+    int sector;				// header sector of the result
+    bool isDir;				// is the result a directory?
+};
+
+// The following class defines the lookup cache, a hash table of
+// DirCacheEntry's chained off a fixed number of buckets.
+
+class DirCache {
+  public:
+    DirCache();				// An empty cache
+    ~DirCache();			// De-allocate the cache
+
+    bool Lookup(int parent, char *name, int *sector, bool *isDir);
+					// Is "name" in "parent" cached?
+					// If so, where is its header?
+    void Enter(int parent, char *name, int sector, bool isDir);
+					// Remember a lookup
+    void Forget(int parent, char *name);// "name" has been removed
+
+  private:
+    List<DirCacheEntry *> *buckets[DirCacheBuckets];
+    Lock *lock;				// lookups run concurrently
+
+    List<DirCacheEntry *> *Bucket(int parent, char *name);
+    DirCacheEntry *FindEntry(int parent, char *name);
+};
+
+#endif // DCACHE_H
@@ -11,10 +11,12 @@
 //	we use ReadFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The entries form a hash table, using linear probing: a name
+//	is kept in the first free entry at or after its "home" entry.
+//	To keep the probe sequences short, the table is never allowed 
+//	to get more than 3/4 full; the file system grows the directory
+//	file and calls Resize before that happens.  Only the entries
+//	that changed are written back to disk.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,6 +24,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "debug.h"
 #include "filehdr.h"
 #include "directory.h"
 #include <stdio.h>
@@ -41,8 +44,11 @@ Directory::Directory(int size)
 {
     table = new DirectoryEntry[size];
     tableSize = size;
+    numEntries = 0;
     for (int i = 0; i < tableSize; i++)
 	table[i].inUse = FALSE;
+    dirtyLow = 0;			// nothing on disk yet
+    dirtyHigh = tableSize - 1;
 }
 
 //----------------------------------------------------------------------
@@ -65,7 +71,20 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
+    int size = file->Length() / sizeof(DirectoryEntry);
+
+    if (size != tableSize) {
+	delete [] table;
+	table = new DirectoryEntry[size];
+	tableSize = size;
+    }
     (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    numEntries = 0;
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse)
+	    numEntries++;
+    dirtyLow = tableSize;
+    dirtyHigh = -1;
 }
 
 //----------------------------------------------------------------------
@@ -78,7 +97,44 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    if (dirtyLow > dirtyHigh)
+	return;				// nothing changed
+    (void) file->WriteAt((char *)&table[dirtyLow], 
+		(dirtyHigh - dirtyLow + 1) * sizeof(DirectoryEntry), 
+		dirtyLow * sizeof(DirectoryEntry));
+    dirtyLow = tableSize;
+    dirtyHigh = -1;
+}
+
+//----------------------------------------------------------------------
+// Directory::MarkDirty
+// 	Note that entry "i" has changed, and has to be written back.
+//----------------------------------------------------------------------
+
+void
+Directory::MarkDirty(int i)
+{
+    dirtyLow = min(dirtyLow, i);
+    dirtyHigh = max(dirtyHigh, i);
+}
+
+//----------------------------------------------------------------------
+// Directory::Home
+// 	Return the entry where the search for "name" starts: its hash
+//	value, modulo the size of the table.  Only the characters that
+//	are stored in an entry count.
+//
+//	"name" -- the file name to hash
+//----------------------------------------------------------------------
+
+int
+Directory::Home(char *name)
+{
+    unsigned int hash = 5381;
+
+    for (int i = 0; i < FileNameMaxLen && name[i] != '\0'; i++)
+	hash = hash * 33 + (unsigned char) name[i];
+    return hash % tableSize;
 }
 
 //----------------------------------------------------------------------
@@ -92,10 +148,10 @@ Directory::WriteBack(OpenFile *file)
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    for (int i = Home(name); table[i].inUse; i = (i + 1) % tableSize)
+        if (!strncmp(table[i].name, name, FileNameMaxLen))
 	    return i;
-    return -1;		// name not in directory
+    return -1;		// hit a free entry: name not in directory
 }
 
 //----------------------------------------------------------------------
@@ -108,13 +164,15 @@ Directory::FindIndex(char *name)
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDir != NULL)
+	*isDir = table[i].isDir;
+    return table[i].sector;
 }
 
 //----------------------------------------------------------------------
@@ -126,22 +184,69 @@ Directory::Find(char *name)
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDir" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDir)
 { 
+    int i;
+
     if (FindIndex(name) != -1)
 	return FALSE;
+    if (IsFull())
+	return FALSE;	// no space; the caller has to Resize first
+
+    for (i = Home(name); table[i].inUse; i = (i + 1) % tableSize)
+	;
+    table[i].inUse = TRUE;
+    strncpy(table[i].name, name, FileNameMaxLen); 
+    table[i].name[FileNameMaxLen] = '\0';
+    table[i].sector = newSector;
+    table[i].isDir = isDir;
+    numEntries++;
+    MarkDirty(i);
+    return TRUE;
+}
 
+//----------------------------------------------------------------------
+// Directory::IsFull
+// 	Return TRUE if adding another file would leave the table more
+//	than 3/4 full.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsFull()
+{
+    return 4 * (numEntries + 1) > 3 * tableSize;
+}
+
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Move all the files into a new table of "newSize" entries, 
+//	re-hashing each name.  The whole table has to be written back.
+//
+//	"newSize" -- the number of entries in the new table
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int newSize)
+{
+    DirectoryEntry *oldTable = table;
+    int oldSize = tableSize;
+
+    ASSERT(4 * numEntries <= 3 * newSize);
+    table = new DirectoryEntry[newSize];
+    tableSize = newSize;
+    numEntries = 0;
     for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+	table[i].inUse = FALSE;
+    for (int i = 0; i < oldSize; i++)
+	if (oldTable[i].inUse)
+	    (void) Add(oldTable[i].name, oldTable[i].sector, oldTable[i].isDir);
+    delete [] oldTable;
+    dirtyLow = 0;
+    dirtyHigh = tableSize - 1;
 }
 
 //----------------------------------------------------------------------
@@ -156,24 +261,57 @@ bool
 Directory::Remove(char *name)
 { 
     int i = FindIndex(name);
+    int j, home;
 
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    numEntries--;
+    MarkDirty(i);
+
+    // Entries after the hole may have been pushed past it when they
+    // were added; move back any whose home is not between the hole
+    // and where they are now, so that FindIndex still finds them.
+    for (j = (i + 1) % tableSize; table[j].inUse; j = (j + 1) % tableSize) {
+	home = Home(table[j].name);
+	if ((i < j) ? (home <= i || home > j) : (home <= i && home > j)) {
+	    table[i] = table[j];
+	    table[j].inUse = FALSE;
+	    MarkDirty(i);
+	    MarkDirty(j);
+	    i = j;
+	}
+    }
     return TRUE;	
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and under each
+//	directory, the files in it, indented one more level.
+//
+//	"depth" -- how deep this directory is in the tree
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(int depth)
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    OpenFile *file;
+    Directory *sub;
+
+    for (int i = 0; i < tableSize; i++)
+	if (table[i].inUse) {
+	    printf("%*s%s%s\n", 2 * depth, "", table[i].name, 
+				table[i].isDir ? "/" : "");
+	    if (table[i].isDir) {
+		file = new OpenFile(table[i].sector);
+		sub = new Directory(NumDirEntries);
+		sub->FetchFrom(file);
+		sub->List(depth + 1);
+		delete sub;
+		delete file;
+	    }
+	}
 }
 
 //----------------------------------------------------------------------
@@ -190,7 +328,8 @@ Directory::Print()
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
 	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	    printf("Name: %s%s, Sector: %d\n", table[i].name, 
+			table[i].isDir ? "/" : "", table[i].sector);
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
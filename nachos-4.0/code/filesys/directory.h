@@ -6,6 +6,10 @@
 //	where to find its file header (the data structure describing
 //	where to find the file's data blocks) on disk.
 //
+//	The table is a hash table: each name goes in the first free
+//	entry at or after the one its hash value picks, so looking a 
+//	name up takes a probe or two no matter how big the directory is.
+//
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -19,8 +23,9 @@
 
 #include "openfile.h"
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		27	// for simplicity, we assume 
+					// file names (each component of a
+					// path) are <= 27 characters long
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,12 +37,17 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool isDir;				// Is the file a directory?
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
 					// the trailing '\0'
 };
 
+// Initial size of a directory; it doubles whenever it gets too full.
+#define NumDirEntries 		16
+#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
@@ -51,33 +61,53 @@ class DirectoryEntry {
 class Directory {
   public:
     Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
+					// with "size" entries
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
+					// (the table takes the size of
+					// the file)
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
 
-    int Find(char *name);		// Find the sector number of the 
-					// FileHeader for file: "name"
+    bool IsFull();			// Would one more file make the hash
+					// table too crowded?
+    int TableSize() { return tableSize; }
+    void Resize(int newSize);		// Move the files to a table with
+					// "newSize" entries
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    int Find(char *name, bool *isDir = NULL);
+					// Find the sector number of the 
+					// FileHeader for file: "name",
+					// and whether it is a directory
+
+    bool Add(char *name, int newSector, bool isDir = FALSE);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
-    void List();			// Print the names of all the files
-					//  in the directory
+    bool IsEmpty() { return numEntries == 0; }
+
+    void List(int depth = 0);		// Print the names of all the files
+					//  in the directory, and in the
+					//  directories under it
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
 
   private:
     int tableSize;			// Number of directory entries
+    int numEntries;			// Number of them in use
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    int dirtyLow, dirtyHigh;		// Range of entries changed since
+					// the last FetchFrom/WriteBack
 
+    int Home(char *name);		// Where the hash of "name" says to
+					//  start looking for it
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
+    void MarkDirty(int i);		// Entry "i" has to be written back
 };
 
 #endif // DIRECTORY_H
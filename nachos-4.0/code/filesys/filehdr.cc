@@ -5,10 +5,14 @@
 //	The file header is used to locate where on disk the 
 //	file's data is stored.  We implement this as a fixed size
 //	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	disk sector containing that portion of the file data -- 
+//	followed by a single indirect block (a sector full of such
+//	pointers) and a doubly indirect block (a sector full of pointers
+//	to indirect blocks).  The table size is chosen so that the file
+//	header will be just big enough to fit in one disk sector.
+//
+//	Indirect blocks are read in the first time they are needed, and
+//	then kept with the in-memory file header.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,33 +31,209 @@
 #include "main.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// NewBlock
+// 	Return an in-memory indirect block with no sectors in it.
+//----------------------------------------------------------------------
+
+static int *
+NewBlock()
+{
+    int *block = new int[NumIndirect];
+
+    for (unsigned int i = 0; i < NumIndirect; i++)
+	block[i] = -1;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header; it is filled in by Allocate
+//	or FetchFrom.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    hdr.numBytes = hdr.numSectors = 0;
+    for (unsigned int i = 0; i < NumDirect; i++)
+	hdr.dataSectors[i] = -1;
+    hdr.singleIndirect = hdr.doubleIndirect = -1;
+    single = doubleTable = NULL;
+    leaves = NULL;
+    extents = NULL;
+    numExtents = 0;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory copy of the file header.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    FreeCache();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeCache
+// 	Forget the indirect blocks and extents we have in memory.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeCache()
+{
+    if (leaves != NULL) {
+	for (unsigned int i = 0; i < NumIndirect; i++)
+	    delete [] leaves[i];
+	delete [] leaves;
+    }
+    delete [] single;
+    delete [] doubleTable;
+    delete [] extents;
+    single = doubleTable = NULL;
+    leaves = NULL;
+    extents = NULL;
+    numExtents = 0;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
+//	Allocate data blocks for the file out of the map of free disk blocks,
+//	along with whatever indirect blocks are needed to find them.
 //	Return FALSE if there are not enough free blocks to accomodate
 //	the new file.
 //
+//	To keep sequential access fast (one seek, then the track buffer
+//	and multi-sector transfers), data sectors are handed out in 
+//	runs: the first free run long enough for the rest of the file, 
+//	searching from "near" on, or failing that the longest run there
+//	is.  Callers pass the sector of the file header as "near", so
+//	the data ends up on the same track if there is room.  The
+//	indirect blocks go after the data.
+//
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the number of bytes in the file
+//	"near" is the sector to start looking for free space at
 //----------------------------------------------------------------------
 
 bool
-FileHeader::Allocate(BitMap *freeMap, int fileSize)
+FileHeader::Allocate(BitMap *freeMap, int fileSize, int near)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    FreeCache();
+    hdr.numBytes = hdr.numSectors = 0;
+    hdr.singleIndirect = hdr.doubleIndirect = -1;
+    for (unsigned int i = 0; i < NumDirect; i++)
+	hdr.dataSectors[i] = -1;
+    return Extend(freeMap, fileSize, near);
+}
+
+//----------------------------------------------------------------------
+// IndirectBlocks, NumLeaves
+// 	Return how many indirect blocks in all, and how many leaves
+//	under the double indirect block, a file of "numSectors" needs.
+//----------------------------------------------------------------------
+
+static int
+NumLeaves(int numSectors)
+{
+    if (numSectors <= (int) (NumDirect + NumIndirect))
+	return 0;
+    return divRoundUp(numSectors - NumDirect - NumIndirect, NumIndirect);
+}
+
+static int
+IndirectBlocks(int numSectors)
+{
+    int numLeaves = NumLeaves(numSectors);
+
+    return (numSectors > (int) NumDirect) + (numLeaves > 0 ? 1 + numLeaves : 0);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newSize" bytes, allocating data blocks (and
+//	indirect blocks) for the new part of the file in runs, as
+//	Allocate does.  Return FALSE, leaving the file as it was, if
+//	there isn't enough free space.  The caller has to WriteBack
+//	the header, and the free map, for the change to stick.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the number of bytes in the file from now on
+//	"near" is the sector to start looking for free space at; by
+//	  default, just past the current end of the file
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(BitMap *freeMap, int newSize, int near)
+{
+    int oldSectors = hdr.numSectors;
+    int numSectors = divRoundUp(newSize, SectorSize);
+    int oldLeaves = NumLeaves(oldSectors), numLeaves = NumLeaves(numSectors);
+    int i, j, start, length;
+
+    if (numSectors <= oldSectors) {	// the last sector has room
+	hdr.numBytes = max(hdr.numBytes, newSize);
+	return TRUE;
+    }
+    if (numSectors > (int) MaxFileSectors)
+	return FALSE;		// too big, even with indirect blocks
+    if (freeMap->NumClear() < numSectors - oldSectors 
+		+ IndirectBlocks(numSectors) - IndirectBlocks(oldSectors))
 	return FALSE;		// not enough space
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->FindAndSet();
+    if (numSectors > (int) NumDirect) {	// indirect blocks we'll fill in
+	if (hdr.singleIndirect == -1 && single == NULL)
+	    single = NewBlock();
+	else
+	    GetSingle();
+    }
+    if (numLeaves > 0) {
+	if (oldLeaves == 0) {
+	    doubleTable = NewBlock();
+	    leaves = new int *[NumIndirect];
+	    for (i = 0; i < (int) NumIndirect; i++)
+		leaves[i] = NULL;
+	} else
+	    GetDouble();
+	for (i = oldLeaves; i < numLeaves; i++)
+	    leaves[i] = NewBlock();
+    }
+
+    if (near == -1)
+	near = (oldSectors > 0) ? *SectorSlot(oldSectors - 1) + 1 : 0;
+    for (i = oldSectors; i < numSectors; ) {	// the data, in runs
+	start = freeMap->FindRun(numSectors - i, near, &length);
+	freeMap->MarkRange(start, length);
+	for (j = 0; j < length; j++, i++)
+	    *SectorSlot(i) = start + j;
+	near = start + length;
+    }
+    if (single != NULL && hdr.singleIndirect == -1) {	// then the new
+	hdr.singleIndirect = freeMap->FindRun(1, near);	// indirect blocks
+	freeMap->Mark(hdr.singleIndirect);
+    }
+    if (numLeaves > 0 && hdr.doubleIndirect == -1) {
+	hdr.doubleIndirect = freeMap->FindRun(1, near);
+	freeMap->Mark(hdr.doubleIndirect);
+    }
+    for (i = oldLeaves; i < numLeaves; i++) {
+	doubleTable[i] = freeMap->FindRun(1, near);
+	freeMap->Mark(doubleTable[i]);
+    }
+
+    hdr.numBytes = newSize;
+    hdr.numSectors = numSectors;
+    delete [] extents;			// have to be worked out again
+    extents = NULL;
+    numExtents = 0;
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the indirect blocks pointing to them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -61,15 +241,28 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int numLeaves, sector;
+
+    for (int i = 0; i < hdr.numSectors; i++) {
+	sector = ByteToSector(i * SectorSize);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (hdr.singleIndirect != -1)
+	freeMap->Clear(hdr.singleIndirect);
+    if (hdr.doubleIndirect != -1) {
+	numLeaves = divRoundUp(hdr.numSectors - NumDirect - NumIndirect, 
+				NumIndirect);
+	for (int i = 0; i < numLeaves; i++)
+	    freeMap->Clear(GetDouble()[i]);
+	freeMap->Clear(hdr.doubleIndirect);
     }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  Indirect blocks are 
+//	fetched later, as they are needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +270,28 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    kernel->synchDisk->ReadSector(sector, (char *)this);
+    ASSERT(sizeof(DiskFileHeader) == SectorSize);
+    FreeCache();
+    kernel->bufferCache->ReadSector(sector, (char *)&hdr);
+}
+
+//----------------------------------------------------------------------
+// WriteLogged
+// 	Write a sector of a file header, through the journal.
+//----------------------------------------------------------------------
+
+static void
+WriteLogged(int sector, char *data)
+{
+    kernel->journal->Log(sector);
+    kernel->bufferCache->WriteSector(sector, data);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with the indirect blocks we have in memory.  These are
+//	metadata, so they go through the journal.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +299,81 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    kernel->synchDisk->WriteSector(sector, (char *)this); 
+    WriteLogged(sector, (char *)&hdr); 
+    if (single != NULL)
+	WriteLogged(hdr.singleIndirect, (char *)single);
+    if (doubleTable != NULL) {
+	WriteLogged(hdr.doubleIndirect, (char *)doubleTable);
+	for (unsigned int i = 0; i < NumIndirect; i++)
+	    if (leaves[i] != NULL)
+		WriteLogged(doubleTable[i], (char *)leaves[i]);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::GetSingle, GetDouble, GetLeaf
+// 	Return an indirect block of the file, reading it from disk if we
+//	don't have it in memory yet.
+//
+//	Several readers of the file may get here at once, and a read 
+//	may let another thread run, so a block is only put in place 
+//	once it has been read in; whoever loses the race throws away
+//	their copy.
+//
+//	"i" -- which of the blocks listed in the double indirect block
+//----------------------------------------------------------------------
+
+int *
+FileHeader::GetSingle()
+{
+    int *block;
+
+    if (single == NULL) {
+	block = new int[NumIndirect];
+	kernel->bufferCache->ReadSector(hdr.singleIndirect, (char *)block);
+	if (single == NULL)
+	    single = block;
+	else
+	    delete [] block;
+    }
+    return single;
+}
+
+int *
+FileHeader::GetDouble()
+{
+    int *block;
+
+    if (doubleTable == NULL) {
+	block = new int[NumIndirect];
+	kernel->bufferCache->ReadSector(hdr.doubleIndirect, (char *)block);
+	if (doubleTable != NULL)
+	    delete [] block;
+	else {
+	    leaves = new int *[NumIndirect];
+	    for (unsigned int i = 0; i < NumIndirect; i++)
+		leaves[i] = NULL;
+	    doubleTable = block;
+	}
+    }
+    return doubleTable;
+}
+
+int *
+FileHeader::GetLeaf(int i)
+{
+    int *block;
+
+    GetDouble();
+    if (leaves[i] == NULL) {
+	block = new int[NumIndirect];
+	kernel->bufferCache->ReadSector(doubleTable[i], (char *)block);
+	if (leaves[i] == NULL)
+	    leaves[i] = block;
+	else
+	    delete [] block;
+    }
+    return leaves[i];
 }
 
 //----------------------------------------------------------------------
@@ -106,9 +389,111 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return *SectorSlot(offset / SectorSize);
 }
 
+//----------------------------------------------------------------------
+// FileHeader::SectorSlot
+// 	Return where the sector number of data block "block" of the file
+//	is kept: in the header itself, or in an indirect block.
+//----------------------------------------------------------------------
+
+int *
+FileHeader::SectorSlot(int block)
+{
+    if (block < (int) NumDirect)
+	return &hdr.dataSectors[block];
+    block -= NumDirect;
+    if (block < (int) NumIndirect)
+	return &GetSingle()[block];
+    block -= NumIndirect;
+    return &GetLeaf(block / NumIndirect)[block % NumIndirect];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ContiguousSectors
+// 	Return how many data sectors of the file, starting with the one
+//	holding byte "offset", follow each other on disk.  This is how
+//	many sectors one disk request could transfer.
+//
+//	"offset" is the location within the file of the first byte
+//----------------------------------------------------------------------
+
+int
+FileHeader::ContiguousSectors(int offset)
+{
+    int block = offset / SectorSize;
+    int lo = 0, hi, mid;
+
+    ASSERT(block < hdr.numSectors);
+    if (extents == NULL)
+	FindExtents();
+    hi = numExtents - 1;
+    while (lo < hi) {			// last extent starting at or
+	mid = (lo + hi + 1) / 2;	// before "block"
+	if (extents[mid].firstBlock <= block)
+	    lo = mid;
+	else
+	    hi = mid - 1;
+    }
+    return extents[lo].firstBlock + extents[lo].length - block;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FindExtents
+// 	Work out the runs of consecutive sectors making up the file.
+//	As with the indirect blocks, another reader may be doing the
+//	same, so the table is only put in place once it is complete.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FindExtents()
+{
+    Extent *table = new Extent[hdr.numSectors];	// at most this many
+    int sector, prev = -2, count = 0;
+
+    for (int i = 0; i < hdr.numSectors; i++) {
+	sector = *SectorSlot(i);
+	if (sector == prev + 1)
+	    table[count - 1].length++;
+	else {
+	    table[count].firstBlock = i;
+	    table[count].firstSector = sector;
+	    table[count].length = 1;
+	    count++;
+	}
+	prev = sector;
+    }
+    if (extents != NULL)
+	delete [] table;
+    else {
+	numExtents = count;
+	extents = table;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::MetaSectors
+// 	Return the number of sectors WriteBack can write for a file of
+//	"fileSize" bytes: the header, and every indirect block the file
+//	needs.  A journal transaction reserves this many (see 
+//	Journal::Begin).
+//----------------------------------------------------------------------
+
+int
+FileHeader::MetaSectors(int fileSize)
+{
+    int sectors = divRoundUp(fileSize, SectorSize);
+    int count = 1;			// the header itself
+
+    if (sectors > (int) NumDirect)
+	count++;			// the single indirect block
+    if (sectors > (int) (NumDirect + NumIndirect))
+	count += 1 + divRoundUp(sectors - (int) (NumDirect + NumIndirect), 
+				(int) NumIndirect);
+    return count;			// ... and the double one, and its
+}					// leaves
+
 //----------------------------------------------------------------------
 // FileHeader::FileLength
 // 	Return the number of bytes in the file.
@@ -117,7 +502,7 @@ FileHeader::ByteToSector(int offset)
 int
 FileHeader::FileLength()
 {
-    return numBytes;
+    return hdr.numBytes;
 }
 
 //----------------------------------------------------------------------
@@ -132,13 +517,14 @@ FileHeader::Print()
     int i, j, k;
     char *data = new char[SectorSize];
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
-    printf("\nFile contents:\n");
-    for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
-        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
+    printf("FileHeader contents.  File size: %d.  File blocks:\n", hdr.numBytes);
+    for (i = 0; i < hdr.numSectors; i++)
+	printf("%d ", ByteToSector(i * SectorSize));
+    printf("\nIndirect blocks: %d %d\n", hdr.singleIndirect, hdr.doubleIndirect);
+    printf("File contents:\n");
+    for (i = k = 0; i < hdr.numSectors; i++) {
+	kernel->bufferCache->ReadSector(ByteToSector(i * SectorSize), data);
+        for (j = 0; (j < SectorSize) && (k < hdr.numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
             else
@@ -17,29 +17,68 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumDirect 	((SectorSize - 4 * sizeof(int)) / sizeof(int))
+#define NumIndirect	(SectorSize / sizeof(int))
+					// sector numbers in an indirect block
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
+
+// The part of a file header that is kept on disk, in a single sector.
+// The first NumDirect data sectors of the file are listed right here.
+// The next NumIndirect are listed in the "single indirect" block; the
+// rest are listed in the blocks listed in the "double indirect" block.
+// Unused pointers are -1.
+
+class DiskFileHeader {
+  public:
+    int numBytes;			// Number of bytes in the file
+    int numSectors;			// Number of data sectors in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for each data 
+					// block in the file
+    int singleIndirect;			// Sector listing the next data sectors
+    int doubleIndirect;			// Sector listing sectors listing the
+					// rest
+};
+
+// A run of consecutive data blocks of a file that are also consecutive
+// on disk.  Extents are not stored on disk -- they are worked out from
+// the sector pointers -- but since Allocate hands out sectors in runs,
+// a file usually has only a few of them.
+
+class Extent {
+  public:
+    int firstBlock;			// first block of the file in the run
+    int firstSector;			// the disk sector holding it
+    int length;				// number of blocks in the run
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// plus a single and a double indirect block, as in UNIX.
 //
-// The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// When it is on disk, the file header is stored in a single sector
+// (see DiskFileHeader).  In memory, we also keep a copy of any indirect 
+// blocks we have used, so that after the first access to a part of the
+// file, translating an offset to a sector needs no disk I/O.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// A file header can be initialized by allocating blocks for the file 
+// (if it is a new file), or by reading it from disk.
 
 class FileHeader {
   public:
-    bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
+    FileHeader();			// An empty file header
+    ~FileHeader();			// De-allocate the in-memory copy
+
+    bool Allocate(BitMap *bitMap, int fileSize, int near = 0);
+						// Initialize a file header, 
 						//  including allocating space 
-						//  on disk for the file data
+						//  on disk for the file data,
+						//  in runs, starting the search
+						//  at sector "near"
+    bool Extend(BitMap *bitMap, int newSize, int near = -1);
+						// Grow the file, allocating
+						//  space for the new blocks
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
 
@@ -53,14 +92,34 @@ class FileHeader {
 
     int FileLength();			// Return the length of the file 
 					// in bytes
+    static int MetaSectors(int fileSize);
+					// Most sectors WriteBack writes for
+					// a file of "fileSize" bytes
+
+    int ContiguousSectors(int offset);	// How many sectors, starting with
+					// the one holding "offset", are
+					// next to each other on disk
 
     void Print();			// Print the contents of the file.
 
   private:
-    int numBytes;			// Number of bytes in the file
-    int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    DiskFileHeader hdr;			// What is stored on disk
+
+    int *single;			// Cached single indirect block, or NULL
+    int *doubleTable;			// Cached double indirect block, or NULL
+    int **leaves;			// Cached blocks it points to (NULL 
+					// until read), or NULL
+
+    int *GetSingle();			// Read in the indirect blocks, if
+    int *GetDouble();			// they aren't cached yet
+    int *GetLeaf(int i);
+    int *SectorSlot(int block);		// Where the sector of a block is kept
+    void FreeCache();			// Forget the cached indirect blocks
+					// and extents
+
+    Extent *extents;			// The file as runs of sectors, worked
+    int numExtents;			// out the first time they are needed
+    void FindExtents();
 };
 
 #endif // FILEHDR_H
@@ -7,37 +7,70 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a directory
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and of the root directory
+//	are located in specific sectors (sector 0 and sector 1), so that
+//	the file system can find them on bootup.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	Files are named by paths, like "/dir/sub/file" -- a series of 
+//	names, each looked up in the directory named by the ones before
+//	it, starting at the root.  The leading "/" is optional.
 //
-//	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	The file system assumes that the bitmap and root directory files
+//	are kept "open" continuously while Nachos is running.
+//
+//	The root directory is also kept in memory, so that looking up a 
+//	name doesn't mean reading the directory file every time.  Other
+//	directories are read as they are needed, but the result of every
+//	lookup is remembered in a cache (cf. dcache.h), so a path used
+//	again is resolved without reading any of them.
+//
+//	The bitmap of free sectors is kept in memory too, under a lock.
+//	Only the part of it that changed is written back.
+//
+//	Threads use the file system concurrently.  Opening a file (or
+//	listing the directories) only looks names up, so any number of
+//	threads can do it at once, sharing the namespace lock; Create,
+//	Mkdir and Remove change directories, and hold it alone.  Reading
+//	and writing files doesn't touch the namespace at all: each file
+//	has a readers/writer lock of its own (cf. openfile.cc), so 
+//	threads using different files never wait for one another, and
+//	neither do threads just reading the same file.
+//
+//	To stay out of deadlock, locks are always taken in this order:
+//	   the namespace lock
+//	   the lock of the file being read, written or removed
+//	   (a transaction begins here, if there is one)
+//	   the lock on the bitmap of free sectors
+//	   the locks of the directory and bitmap files, as they are
+//	    written back
+//	   the locks of the header cache, the lookup cache, the journal,
+//	    the buffer cache, and the log-structured disk, in that order
+//	Nothing that holds a lower one waits for a higher one.
+//
+//	Each operation that modifies the file system (Create, Mkdir,
+//	Remove) is a transaction in the journal (cf. journal.h): the 
+//	file headers, directory and bitmap sectors it writes reach the
+//	disk all together, or not at all, even if Nachos stops in the
+//	middle.  If the operation fails, we put back any sectors we
+//	took from the bitmap; the in-memory directory is only changed
+//	once the operation is sure to succeed.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   files grow as they are written, but never shrink
+//	   files cannot be bigger than MaxFileSize (see filehdr.h)
+//	   only metadata is journaled (if Nachos exits in the middle of
+//	    writing a file, the file may be left with some of the new
+//	    data and some of the old)
+//	   an operation that would change more metadata than the journal
+//	    holds (such as doubling a very big directory) fails
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -48,33 +81,41 @@
 #include "disk.h"
 #include "bitmap.h"
 #include "directory.h"
+#include "dcache.h"
 #include "filehdr.h"
 #include "filesys.h"
 #include "debug.h"
 #include "pbitmap.h"
+#include "journal.h"
+#include "synch.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
+// and the root directory.  These file headers are placed in well-known 
 // sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file size for the bitmap (for directories, see directory.h).
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+
+// Most sectors a transaction can log for the bitmap, and for the 
+// entries of a directory of "n" entries (see Journal::Begin).
+#define FreeMapSectors		divRoundUp(FreeMapFileSize, SectorSize)
+#define DirSectors(n)		((int) divRoundUp((n) * sizeof(DirectoryEntry), \
+					SectorSize))
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
 //	nothing on it, and we need to initialize the disk to contain
-//	an empty directory, and a bitmap of free sectors (with almost but
-//	not all of the sectors marked as free).  
+//	an empty root directory, and a bitmap of free sectors (with almost
+//	but not all of the sectors marked as free).  
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we replay the journal, in case Nachos stopped
+//	in the middle of an update, and open the files representing the
+//	bitmap and the root directory.  A disk with no journal on it has
+//	never been formatted, so we format it anyway.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -82,24 +123,35 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG(dbgFile, "Initializing the file system.");
+    dirCache = new DirCache;
+    freeMapLock = new Lock("free map lock");
+    namespaceLock = new RWLock("namespace lock");
+    if (!format && !kernel->journal->Recover()) {
+	DEBUG(dbgFile, "No file system on the disk.");
+	format = TRUE;
+    }
     if (format) {
-        PersistBitMap *freeMap = new PersistBitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
+        freeMap = new PersistBitMap(NumSectors);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
         DEBUG(dbgFile, "Formatting the file system.");
+        directory = new Directory(NumDirEntries);
+	kernel->journal->Format();
 
-    // First, allocate space for FileHeaders for the directory and bitmap
-    // (make sure no one else grabs these!)
+    // First, allocate space for FileHeaders for the directory and bitmap,
+    // and for the journal (make sure no one else grabs these!)
 	freeMap->Mark(FreeMapSector);	    
 	freeMap->Mark(DirectorySector);
+	freeMap->MarkRange(JournalSector, JournalSectors);
+	if (kernel->logDisk != NULL)	// a log only has room for so many
+	    freeMap->MarkRange(LogSectors, NumSectors - LogSectors);
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
 
-	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
-	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
+	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize, FreeMapSector));
+	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize, DirectorySector));
 
     // Flush the bitmap and directory FileHeaders back to disk
     // We need to do this before we can "Open" the file, since open
@@ -116,6 +168,8 @@ FileSystem::FileSystem(bool format)
 
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+	freeMapFile->JournalWrites();
+	directoryFile->JournalWrites();
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
@@ -131,16 +185,189 @@ FileSystem::FileSystem(bool format)
 	    freeMap->Print();
 	    directory->Print();
         }
-        delete freeMap; 
-	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
+	Sync();				// the new file system is on disk
     } else {
     // if we are not formatting the disk, just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
+	freeMapFile->JournalWrites();
+	directoryFile->JournalWrites();
+        freeMap = new PersistBitMap(freeMapFile, NumSectors);
+        directory = new Directory(NumDirEntries);
+        directory->FetchFrom(directoryFile);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap and root directory files.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    Sync();
+    delete freeMap;
+    delete freeMapLock;
+    delete namespaceLock;
+    delete dirCache;
+    delete directory;
+    delete freeMapFile;
+    delete directoryFile;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Commit every change made so far to the disk, without waiting
+//	for the journal to gather a full group.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    kernel->journal->Flush();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory
+// 	Return the directory with its header in "sector", and the file
+//	holding it.  The root directory is already in memory; any other
+//	is read in.  The caller hands both back with CloseDirectory.
+//
+//	"sector" -- the header sector of the directory
+//	"file" -- where to return the directory file
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::OpenDirectory(int sector, OpenFile **file)
+{
+    Directory *dir;
+
+    if (sector == DirectorySector) {
+	*file = directoryFile;
+	return directory;
     }
+    *file = new OpenFile(sector);
+    (*file)->JournalWrites();
+    dir = new Directory(NumDirEntries);
+    dir->FetchFrom(*file);
+    return dir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseDirectory
+// 	Done with a directory returned by OpenDirectory.
+//----------------------------------------------------------------------
+
+void
+FileSystem::CloseDirectory(int sector, Directory *dir, OpenFile *file)
+{
+    if (sector != DirectorySector) {
+	delete dir;
+	delete file;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupEntry
+// 	Look up "name" in the directory with its header in "dirSector".
+//	Return the sector of its file header, or -1 if it isn't there,
+//	and whether it is a directory.  The lookup cache is tried first.
+//
+//	"dirSector" -- the header sector of the directory to look in
+//	"name" -- the name to look up (one component of a path)
+//	"isDir" -- where to return whether "name" is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupEntry(int dirSector, char *name, bool *isDir)
+{
+    Directory *dir;
+    OpenFile *file;
+    int sector;
+
+    if (dirCache->Lookup(dirSector, name, &sector, isDir))
+	return sector;
+    dir = OpenDirectory(dirSector, &file);
+    sector = dir->Find(name, isDir);
+    if (sector != -1)
+	dirCache->Enter(dirSector, name, sector, *isDir);
+    CloseDirectory(dirSector, dir, file);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindDir
+// 	Resolve all but the last name in "path".  Return the header
+//	sector of the directory the last name belongs in, and copy the
+//	last name into "name".  Return -1 if a directory along the way
+//	doesn't exist (or isn't a directory), or if a name is too long.
+//
+//	"path" -- the path to resolve, like "/dir/sub/file"
+//	"name" -- where to put the last name, with room for 
+//		FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::FindDir(char *path, char *name)
+{
+    int dirSector = DirectorySector;
+    bool isDir;
+    int len;
+
+    for (;;) {
+	while (*path == '/')
+	    path++;
+	for (len = 0; path[len] != '/' && path[len] != '\0'; len++)
+	    ;
+	if (len == 0 || len > FileNameMaxLen)
+	    return -1;			// no name, or too long a one
+	strncpy(name, path, len);
+	name[len] = '\0';
+	path += len;
+	while (*path == '/')
+	    path++;
+	if (*path == '\0')
+	    return dirSector;		// that was the last name
+	dirSector = LookupEntry(dirSector, name, &isDir);
+	if (dirSector == -1 || !isDir)
+	    return -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::GrowDirectory
+// 	Double the number of entries in a directory, extending the
+//	directory file to hold them.  Return FALSE if there is no room
+//	on the disk.  The new directory header is written back; the
+//	caller writes back the directory itself, and holds 
+//	"freeMapLock".
+//
+//	The header is the one shared by every open of the directory 
+//	file, so they all see the new length right away.
+//
+//	"dir" -- the directory to grow
+//	"dirSector" -- the header sector of the directory
+//	"freeMap" -- the bit map of free disk sectors
+//----------------------------------------------------------------------
+
+bool
+FileSystem::GrowDirectory(Directory *dir, int dirSector, PersistBitMap *freeMap)
+{
+    FileHeader *dirHdr = kernel->headerCache->Acquire(dirSector);
+    int newSize = 2 * dir->TableSize();
+    bool success;
+
+    success = dirHdr->Extend(freeMap, newSize * sizeof(DirectoryEntry));
+    if (success) {
+	DEBUG(dbgFile, "Growing directory " << dirSector << " to " << newSize << " entries");
+	dirHdr->WriteBack(dirSector);
+	dir->Resize(newSize);
+    }
+    kernel->headerCache->Release(dirHdr);
+    return success;
 }
 
 //----------------------------------------------------------------------
@@ -149,69 +376,136 @@ FileSystem::FileSystem(bool format)
 //	Since we can't increase the size of files dynamically, we have
 //	to give Create the initial size of the file.
 //
+//	"name" -- path name of file to be created
+//	"initialSize" -- size of file to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Create(char *name, int initialSize)
+{
+    return MakeEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (similar to UNIX mkdir).
+//
+//	"name" -- path name of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Mkdir(char *name)
+{
+    return MakeEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::MakeEntry
+// 	Create a file or a directory.
+//
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	  Grow the directory, if it is getting full
 //	  Add the name to the directory
 //	  Store the new file header on disk 
 //	  Flush the changes to the bitmap and the directory back to disk
+//	  For a directory, write an empty directory into the new file
+//
+//	All of this is one transaction in the journal, done holding the
+//	namespace lock alone.
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		a directory in the path doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
+//	 	no free space to grow the directory
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"path" -- path name of file to be created
 //	"initialSize" -- size of file to be created
+//	"isDir" -- is it a directory?
 //----------------------------------------------------------------------
 
 bool
-FileSystem::Create(char *name, int initialSize)
+FileSystem::MakeEntry(char *path, int initialSize, bool isDir)
 {
-    Directory *directory;
-    PersistBitMap *freeMap;
+    char name[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *dirFile;
     FileHeader *hdr;
-    int sector;
-    bool success;
-
-    DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+    int dirSector, sector, numBlocks;
+    bool success, found;
+
+    DEBUG(dbgFile, "Creating " << (isDir ? "directory " : "file ") << path 
+			<< " size " << initialSize);
+
+    namespaceLock->WriteAcquire();
+    dirSector = FindDir(path, name);
+    if (dirSector == -1 || LookupEntry(dirSector, name, &found) != -1) {
+	namespaceLock->WriteRelease();
+	return FALSE;			// no such directory, or file is 
+    }					// already in directory
+
+    // what the transaction can log: the new header, the bitmap, and 
+    // the new entry -- or, if the directory has to grow, all of it
+    // and its header; and a new directory's empty table
+    dir = OpenDirectory(dirSector, &dirFile);
+    numBlocks = FileHeader::MetaSectors(initialSize) + FreeMapSectors;
+    if (dir->IsFull())
+	numBlocks += DirSectors(2 * dir->TableSize()) + FileHeader::
+		MetaSectors(2 * dir->TableSize() * sizeof(DirectoryEntry));
+    else
+	numBlocks += DirSectors(1) + 1;	// an entry may straddle two
+    if (isDir)
+	numBlocks += DirSectors(NumDirEntries);
+    if (!kernel->journal->Begin(numBlocks)) {
+	CloseDirectory(dirSector, dir, dirFile);
+	namespaceLock->WriteRelease();
+	return FALSE;			// too big to do all at once
+    }
+    freeMapLock->Acquire();
+    sector = freeMap->FindAndSet();	// find a sector to hold the file header
+    if (sector == -1) 		
+	success = FALSE;		// no free block for file header 
+    else {
+	hdr = new FileHeader;
+	if (!hdr->Allocate(freeMap, initialSize, sector)) {
+	    success = FALSE;		// no space on disk for data
+	    freeMap->Clear(sector);
+	} else if (dir->IsFull() && !GrowDirectory(dir, dirSector, freeMap)) {
+	    success = FALSE;		// no space to grow the directory
+	    hdr->Deallocate(freeMap);
+	    freeMap->Clear(sector);
+	} else {	
+	    success = TRUE;
+	    // everthing worked, flush all changes back to disk
+	    ASSERT(dir->Add(name, sector, isDir));
+	    hdr->WriteBack(sector); 		
+	    dir->WriteBack(dirFile);
+	    freeMap->WriteBack(freeMapFile);
+	    dirCache->Enter(dirSector, name, sector, isDir);
+	}
+	delete hdr;
+    }
+    freeMapLock->Release();
+    CloseDirectory(dirSector, dir, dirFile);
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+    if (success && isDir) {		// start the new directory out empty
+	OpenFile *newFile = new OpenFile(sector);
+	Directory *newDir = new Directory(NumDirEntries);
 
-    if (directory->Find(name) != -1)
-      success = FALSE;			// file is already in directory
-    else {	
-        freeMap = new PersistBitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        sector = freeMap->FindAndSet();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = FALSE;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = FALSE;	// no space in directory
-	else {
-    	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
-            	success = FALSE;	// no space on disk for data
-	    else {	
-	    	success = TRUE;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
-            delete hdr;
-	}
-        delete freeMap;
+	newFile->JournalWrites();
+	newDir->WriteBack(newFile);
+	delete newDir;
+	delete newFile;
     }
-    delete directory;
+    kernel->journal->End(numBlocks);
+    namespaceLock->WriteRelease();
     return success;
 }
 
@@ -219,96 +513,158 @@ FileSystem::Create(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
 //	  Bring the header into memory
+//	Other threads may be looking up names at the same time.
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
+    char last[FileNameMaxLen + 1];
     OpenFile *openFile = NULL;
-    int sector;
+    int dirSector, sector = -1;
+    bool isDir;
 
     DEBUG(dbgFile, "Opening file" << name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
+    namespaceLock->ReadAcquire();
+    dirSector = FindDir(name, last);
+    if (dirSector != -1)
+	sector = LookupEntry(dirSector, last, &isDir); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    namespaceLock->ReadRelease();
     return openFile;				// return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
+//	all in one transaction in the journal.
+//
+//	A directory can only be removed if it is empty.
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory with files in it.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(char *name)
 { 
-    Directory *directory;
-    PersistBitMap *freeMap;
+    char last[FileNameMaxLen + 1];
+    Directory *dir;
+    OpenFile *dirFile;
     FileHeader *fileHdr;
-    int sector;
+    RWLock *fileLock;
+    int dirSector, sector = -1, numBlocks;
+    bool isDir, empty = TRUE;
     
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
-       return FALSE;			 // file not found 
+    namespaceLock->WriteAcquire();
+    dirSector = FindDir(name, last);
+    if (dirSector != -1)
+	sector = LookupEntry(dirSector, last, &isDir);
+    if (sector != -1 && isDir) {
+	dir = OpenDirectory(sector, &dirFile);
+	empty = dir->IsEmpty();
+	CloseDirectory(sector, dir, dirFile);
+    }
+    if (sector == -1 || !empty) {
+	namespaceLock->WriteRelease();
+	return FALSE;			 // file not found, or directory
+    }					 // still has files in it
+
+    // wait for anyone in the middle of reading or writing the file,
+    // so no one uses its sectors once they are free
+    fileHdr = kernel->headerCache->Acquire(sector);
+    fileLock = kernel->headerCache->LockOf(fileHdr);
+    fileLock->WriteAcquire();
+    // taking the entry out may move any of the others back
+    dir = OpenDirectory(dirSector, &dirFile);
+    numBlocks = FreeMapSectors + DirSectors(dir->TableSize());
+    if (!kernel->journal->Begin(numBlocks)) {
+	CloseDirectory(dirSector, dir, dirFile);
+	fileLock->WriteRelease();
+	kernel->headerCache->Release(fileHdr);
+	namespaceLock->WriteRelease();
+	return FALSE;
     }
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new PersistBitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
 
+    freeMapLock->Acquire();
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
-
     freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
-    delete fileHdr;
-    delete directory;
-    delete freeMap;
+    freeMapLock->Release();
+    kernel->headerCache->Forget(fileHdr);	// in case it's still open
+    fileLock->WriteRelease();
+    dir->Remove(last);
+    dirCache->Forget(dirSector, last);
+
+    dir->WriteBack(dirFile);			// flush to disk
+    CloseDirectory(dirSector, dir, dirFile);
+    kernel->journal->End(numBlocks);
+    kernel->headerCache->Release(fileHdr);
+    namespaceLock->WriteRelease();
     return TRUE;
 } 
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Grow an open file to "newSize" bytes, as one transaction.  Return
+//	FALSE, leaving the file as it was, if there isn't room.  The 
+//	caller holds the file's lock alone.
+//
+//	"hdr" -- the file's header, as cached
+//	"sector" -- where the header lives on disk
+//	"newSize" -- the length of the file from now on
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(FileHeader *hdr, int sector, int newSize)
+{
+    int numBlocks = FileHeader::MetaSectors(newSize) + FreeMapSectors;
+    bool success;
+
+    DEBUG(dbgFile, "Extending file " << sector << " to " << newSize << " bytes");
+    if (!kernel->journal->Begin(numBlocks))
+	return FALSE;
+    freeMapLock->Acquire();
+    success = hdr->Extend(freeMap, newSize);
+    if (success) {
+	hdr->WriteBack(sector);
+	freeMap->WriteBack(freeMapFile);
+    }
+    freeMapLock->Release();
+    kernel->journal->End(numBlocks);
+    return success;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, directory by directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
+    namespaceLock->ReadAcquire();
     directory->List();
-    delete directory;
+    namespaceLock->ReadRelease();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
 //	  the contents of the bitmap
-//	  the contents of the directory
-//	  for each file in the directory,
+//	  the contents of the root directory
+//	  for each file in the root directory,
 //	      the contents of the file header
 //	      the data in the file
 //----------------------------------------------------------------------
@@ -318,9 +674,8 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    PersistBitMap *freeMap = new PersistBitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
+    namespaceLock->ReadAcquire();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -329,14 +684,62 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
+    freeMapLock->Acquire();
     freeMap->Print();
+    freeMapLock->Release();
 
-    directory->FetchFrom(directoryFile);
     directory->Print();
+    namespaceLock->ReadRelease();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
+} 
+
+//----------------------------------------------------------------------
+// FileSystem::SelfTest
+// 	Test directories and path names: make a directory in a new
+//	directory, create a file in that, and read back what was written
+//	to it through its path.  A name must not be found in any other
+//	directory, and a directory can't be removed while it has files
+//	in it.  Everything made is removed again.
+//----------------------------------------------------------------------
+
+#define TestDir		"/fstest"
+#define TestSubDir	"/fstest/sub"
+#define TestFile	"/fstest/sub/file"
+
+void
+FileSystem::SelfTest()
+{
+    char out[2 * SectorSize + 10], in[2 * SectorSize + 10];
+    int size = sizeof(out);
+    OpenFile *file;
+
+    for (int i = 0; i < size; i++)
+	out[i] = 'a' + i % 26;
+    ASSERT(Mkdir(TestDir));
+    ASSERT(Mkdir(TestSubDir));
+    ASSERT(!Mkdir(TestSubDir));			// there already
+    ASSERT(!Mkdir("/nodir/sub"));		// no such directory
+    ASSERT(Create(TestFile, 0));
+
+    file = Open(TestFile);
+    ASSERT(file != NULL);
+    ASSERT(file->Write(out, size) == size);
+    delete file;
+
+    ASSERT(Open("/fstest/file") == NULL);	// in another directory
+    ASSERT(Open("/sub/file") == NULL);
+    ASSERT(Open("/fstest/sub/file/x") == NULL);	// not a directory
+    file = Open("//fstest//sub/file");		// extra slashes are ignored
+    ASSERT(file != NULL);
+    ASSERT(file->Read(in, size) == size);
+    ASSERT(bcmp(in, out, size) == 0);
+    delete file;
+
+    ASSERT(!Remove(TestDir));			// has files in it
+    ASSERT(Remove(TestFile));
+    ASSERT(Remove(TestSubDir));
+    ASSERT(Remove(TestDir));
+    ASSERT(Open(TestFile) == NULL);
 }
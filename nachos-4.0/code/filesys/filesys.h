@@ -20,9 +20,9 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
+//	in the file system.  There is a tree of directories, starting at
+//	the "root" directory; as in UNIX, a file is named by the path of
+//	directories leading to it, like "/dir/sub/file".  
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -38,6 +38,12 @@
 #include "copyright.h"
 #include "openfile.h"
 
+class Directory;
+class DirCache;
+class PersistBitMap;
+class Lock;
+class RWLock;
+
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
 				// implementation is available
@@ -62,34 +68,70 @@ class FileSystem {
 
     bool Remove(char *name) { return Unlink(name) == 0; }
 
+    bool Mkdir(char *name) { return FALSE; }	// no directories here
+
 };
 
 #else // FILESYS
 class FileSystem {
   public:
     FileSystem(bool format=true);		// Initialize the file system.
-					// Must be called *after* "synchDisk" 
-					// has been initialized.
+					// Must be called *after* "synchDisk",
+					// "bufferCache" and "journal" have 
+					// been initialized.
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+					// Otherwise, replay the journal.
+    ~FileSystem();
 
     bool Create(char *name, int initialSize);  	
 					// Create a file (UNIX creat)
 
+    bool Mkdir(char *name);		// Create a directory (UNIX mkdir)
+
     OpenFile* Open(char *name); 	// Open a file (UNIX open)
 
-    bool Remove(char *name);  		// Delete a file (UNIX unlink)
+    bool Remove(char *name);  		// Delete a file (UNIX unlink), or
+					// an empty directory (UNIX rmdir)
+
+    bool Extend(FileHeader *hdr, int sector, int newSize);
+					// Grow an open file
 
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
 
+    void Sync();			// Commit all changes to disk
+
+    void SelfTest();			// Test directories and path names
+
   private:
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
+   PersistBitMap* freeMap;		// In-memory copy of the bit map
+   Lock* freeMapLock;			// Protects "freeMap"
+   RWLock* namespaceLock;		// Protects the directories: shared
+					// by lookups, held alone by changes
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   Directory* directory;		// In-memory copy of the root 
+					// directory, kept up to date with
+					// the file
+   DirCache* dirCache;			// Results of recent name lookups
+
+   Directory* OpenDirectory(int sector, OpenFile **file);
+   void CloseDirectory(int sector, Directory *dir, OpenFile *file);
+					// Get hold of the directory with its
+					// header in "sector", and let go
+   int LookupEntry(int dirSector, char *name, bool *isDir);
+					// Look up one name in a directory
+   int FindDir(char *path, char *name);	// Find the directory the last name
+					// in "path" belongs in
+   bool GrowDirectory(Directory *dir, int dirSector, PersistBitMap *freeMap);
+					// Double the size of a directory
+   bool MakeEntry(char *path, int initialSize, bool isDir);
+					// Create a file or a directory
 };
 
 #endif // FILESYS
@@ -0,0 +1,157 @@
+// hdrcache.cc 
+//	Routines to manage the cache of file headers.
+//
+//	The cache only holds headers that someone is using, so it is
+//	never bigger than the number of open files; a List is enough.
+//	A file that is deleted while it is still open keeps its entry
+//	(marked removed) until the last user lets go, but a new file 
+//	whose header lands in the same sector gets an entry of its own.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "hdrcache.h"
+#include "filehdr.h"
+#include "synch.h"
+#include "debug.h"
+
+//----------------------------------------------------------------------
+// HeaderCache::HeaderCache
+// 	Initialize an empty file header cache.
+//----------------------------------------------------------------------
+
+HeaderCache::HeaderCache()
+{
+    headers = new List<CachedHeader *>;
+    lock = new Lock("header cache");
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::~HeaderCache
+// 	De-allocate the cache, and any headers still in it.
+//----------------------------------------------------------------------
+
+HeaderCache::~HeaderCache()
+{
+    CachedHeader *entry;
+
+    while (!headers->IsEmpty()) {
+	entry = headers->RemoveFront();
+	delete entry->fileLock;
+	delete entry->hdr;
+	delete entry;
+    }
+    delete headers;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Find
+// 	Return the cache entry holding "hdr".
+//----------------------------------------------------------------------
+
+CachedHeader *
+HeaderCache::Find(FileHeader *hdr)
+{
+    ListIterator<CachedHeader *> iter(headers);
+
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->hdr == hdr)
+	    return iter.Item();
+    }
+    ASSERTNOTREACHED();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Acquire
+// 	Return the file header stored in "sector", adding a reference
+//	to it.  If nobody has it yet, read it in from disk.
+//
+//	"sector" -- the disk sector containing the file header
+//----------------------------------------------------------------------
+
+FileHeader *
+HeaderCache::Acquire(int sector)
+{
+    ListIterator<CachedHeader *> iter(headers);
+    CachedHeader *entry = NULL;
+
+    lock->Acquire();
+    for (; !iter.IsDone(); iter.Next()) {
+	if (iter.Item()->sector == sector && !iter.Item()->removed) {
+	    entry = iter.Item();
+	    break;
+	}
+    }
+    if (entry == NULL) {
+	DEBUG(dbgFile, "Reading in file header " << sector);
+	entry = new CachedHeader;
+	entry->sector = sector;
+	entry->hdr = new FileHeader;
+	entry->hdr->FetchFrom(sector);
+	entry->refCount = 0;
+	entry->removed = FALSE;
+	entry->fileLock = new RWLock("file lock");
+	headers->Append(entry);
+    }
+    entry->refCount++;
+    lock->Release();
+    return entry->hdr;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Release
+// 	Drop a reference to "hdr".  When the last one goes, take it out
+//	of the cache; it is on disk already.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Release(FileHeader *hdr)
+{
+    CachedHeader *entry;
+
+    lock->Acquire();
+    entry = Find(hdr);
+    ASSERT(entry->refCount > 0);
+    if (--entry->refCount == 0) {
+	headers->Remove(entry);
+	delete entry->fileLock;
+	delete hdr;
+	delete entry;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::LockOf
+// 	Return the readers/writer lock on the file "hdr" belongs to.  It
+//	lasts as long as the caller's reference to the header.
+//----------------------------------------------------------------------
+
+RWLock *
+HeaderCache::LockOf(FileHeader *hdr)
+{
+    RWLock *fileLock;
+
+    lock->Acquire();
+    fileLock = Find(hdr)->fileLock;
+    lock->Release();
+    return fileLock;
+}
+
+//----------------------------------------------------------------------
+// HeaderCache::Forget
+// 	The file "hdr" belongs to has been deleted, and its sectors 
+//	freed; don't ever hand the header out again.
+//----------------------------------------------------------------------
+
+void
+HeaderCache::Forget(FileHeader *hdr)
+{
+    lock->Acquire();
+    Find(hdr)->removed = TRUE;
+    lock->Release();
+}
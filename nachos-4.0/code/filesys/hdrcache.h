@@ -0,0 +1,63 @@
+// hdrcache.h 
+//	Data structures for a cache of file headers (in UNIX terms, an
+//	in-core i-node table).
+//
+//	Every OpenFile of a file shares one in-memory FileHeader, found
+//	here by the sector the header lives in.  So a second open of a
+//	file costs no disk read, and a change one OpenFile makes to the
+//	header (say, growing the file) is seen by all the others at once.
+//	The header stays cached while anyone has the file open.  Whoever
+//	changes a header writes it back at once, as part of the journal
+//	transaction making the change (see FileSystem::Extend), so a
+//	cached header is never newer than the disk.
+//
+//	Each cached header also carries the file's readers/writer lock,
+//	so that every OpenFile of the file shares the one lock too.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef HDRCACHE_H
+#define HDRCACHE_H
+
+#include "copyright.h"
+#include "list.h"
+
+class FileHeader;
+class Lock;
+class RWLock;
+
+// One cached file header.
+
+class CachedHeader {
+  public:
+    int sector;				// where the header lives on disk
+    FileHeader *hdr;			// the header itself
+    int refCount;			// how many users have it
+    bool removed;			// file deleted: never hand it out
+    RWLock *fileLock;			// readers/writer lock on the file
+};
+
+// The following class defines the file header cache.
+
+class HeaderCache {
+  public:
+    HeaderCache();			// An empty cache
+    ~HeaderCache();			// De-allocate the cache
+
+    FileHeader *Acquire(int sector);	// Return the header in "sector",
+					// reading it in if it isn't cached
+    void Release(FileHeader *hdr);	// Done with a header; the last
+					// user takes it out of the cache
+    RWLock *LockOf(FileHeader *hdr);	// The lock on the file "hdr" is for
+    void Forget(FileHeader *hdr);	// The file has been deleted
+
+  private:
+    List<CachedHeader *> *headers;	// the headers in use
+    Lock *lock;				// one request at a time
+
+    CachedHeader *Find(FileHeader *hdr);
+};
+
+#endif // HDRCACHE_H
@@ -0,0 +1,415 @@
+// journal.cc
+//	Routines to manage the write-ahead journal of file system
+//	metadata.
+//
+//	A group is committed in four steps:
+//	  Write the descriptor and the logged sectors to the journal
+//	    area, in one request
+//	  Write the commit record, naming how many sectors there are;
+//	    from here on, the group survives a crash
+//	  Write each logged sector home
+//	  Write the commit record again, with no sectors
+//
+//	Recovery only has to look at the commit record: if it names any
+//	sectors, the last group may not have reached home, so it is
+//	copied home again.  Doing that twice does no harm.
+//
+//	A group is committed once enough transactions have ended, or
+//	half of what the journal can hold has been logged.  We only 
+//	commit when no transaction is in the middle of things, so a
+//	group never holds half of a transaction.  For that, a running
+//	transaction must never find the group full: each one reserves
+//	room for the most it can log when it begins, and waits until
+//	the group has that much left over, counting the reservations of
+//	the others.  Sectors the others have logged already are counted
+//	twice, which only makes us commit a little early.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "synchdisk.h"
+#include "bufcache.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize an empty journal.  Every logged sector is pinned in
+//	the buffer cache until its group commits, so the caller should
+//	leave room in the cache for other sectors.
+//
+//	"disk" -- the disk the journal lives on
+//	"maxBlocks" -- the most sectors to log in one group; 0 turns
+//		journaling off
+//----------------------------------------------------------------------
+
+Journal::Journal(SynchDisk *disk, int maxBlocks)
+{
+    synchDisk = disk;
+    capacity = min(maxBlocks, JournalBlocks);
+    blocks = new char[JournalBlocks * SectorSize];
+    numLogged = numTransactions = numActive = reserved = 0;
+    sequence = 0;
+    lock = new Lock("journal lock");
+    idle = new Condition("journal idle");
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	Commit anything still logged, and de-allocate the journal.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    Flush();
+    delete idle;
+    delete lock;
+    delete [] blocks;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Write an empty journal, throwing away whatever was there, so
+//	that nothing on the disk is replayed over a new file system.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    sequence = 0;
+    WriteRecord(0);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read the commit record.  If the last group committed never got
+//	all the way home, copy it home again.  Return FALSE if there is
+//	no journal, which means there is no file system on the disk.
+//----------------------------------------------------------------------
+
+bool
+Journal::Recover()
+{
+    CommitRecord record;
+    int descriptor[JournalBlocks];
+    char *data[JournalBlocks];
+
+    synchDisk->ReadSector(JournalSector, (char *)&record);
+    if (record.magic != JournalMagic)
+	return FALSE;
+    sequence = record.sequence + 1;
+    if (record.numBlocks > 0) {
+	DEBUG(dbgFile, "Replaying " << record.numBlocks <<
+			" sectors of journal group " << record.sequence);
+	ASSERT(record.numBlocks <= JournalBlocks);
+	synchDisk->ReadSector(DescriptorSector, (char *)descriptor);
+	for (int i = 0; i < record.numBlocks; i++)
+	    data[i] = &blocks[i * SectorSize];
+	synchDisk->ReadSectors(DescriptorSector + 1, record.numBlocks, data);
+	WriteHome(descriptor, blocks, record.numBlocks);
+	WriteRecord(0);
+	kernel->stats->numJournalReplays++;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a transaction that will log at most "numBlocks" sectors.
+//	If the group is due to be committed, or hasn't room for that
+//	many, wait for the transactions in it to end, and commit it 
+//	first.  Return FALSE, starting nothing, if "numBlocks" is more
+//	than the journal holds at all.
+//
+//	"numBlocks" -- the most sectors the transaction may Log
+//----------------------------------------------------------------------
+
+bool
+Journal::Begin(int numBlocks)
+{
+    if (capacity == 0)
+	return TRUE;
+    if (numBlocks > capacity) {
+	DEBUG(dbgFile, "Transaction of " << numBlocks << 
+			" sectors won't fit in the journal");
+	return FALSE;
+    }
+    lock->Acquire();
+    while (GroupFull() || numLogged + reserved + numBlocks > capacity) {
+	if (numActive == 0) {
+	    Commit();			// empty now, so there is room
+	    break;
+	}
+	idle->Wait(lock);
+    }
+    numActive++;
+    reserved += numBlocks;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Log
+// 	Add "sector" to the group, unless it is there already, and pin
+//	it in the buffer cache.  Called before the sector is written.
+//
+//	A transaction always has room (see Begin).  Only the writes made
+//	outside of any, while the disk is formatted, can find the group 
+//	full; with nothing running, we can just commit it first.
+//----------------------------------------------------------------------
+
+void
+Journal::Log(int sector)
+{
+    if (capacity == 0)
+	return;
+    lock->Acquire();
+    for (int i = 0; i < numLogged; i++) {
+	if (home[i] == sector) {
+	    lock->Release();
+	    return;			// absorbed: logged once per group
+	}
+    }
+    if (numLogged == capacity) {
+	ASSERT(numActive == 0);		// else it logged more than it said
+	Commit();
+    }
+    home[numLogged++] = sector;
+    kernel->bufferCache->Pin(sector);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish a transaction, giving back its reservation.  If it was
+//	the last one running, and the group is due, commit the group.
+//
+//	"numBlocks" -- what was reserved by Begin
+//----------------------------------------------------------------------
+
+void
+Journal::End(int numBlocks)
+{
+    if (capacity == 0)
+	return;
+    lock->Acquire();
+    ASSERT(numActive > 0);
+    numActive--;
+    numTransactions++;
+    reserved -= numBlocks;
+    if (numActive == 0 && GroupFull())
+	Commit();
+    idle->Broadcast(lock);		// there may be room now
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Flush
+// 	Wait for the transactions running to end, and commit the group,
+//	however small.
+//----------------------------------------------------------------------
+
+void
+Journal::Flush()
+{
+    if (capacity == 0)
+	return;
+    lock->Acquire();
+    while (numActive > 0)
+	idle->Wait(lock);
+    Commit();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::GroupFull
+// 	Return TRUE if the group should be committed.
+//----------------------------------------------------------------------
+
+bool
+Journal::GroupFull()
+{
+    return numTransactions >= GroupCommitSize || numLogged >= capacity / 2;
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Commit the group, write it home, and start a new one.  The
+//	caller holds the lock, and no transaction is running.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    numTransactions = 0;
+    if (numLogged == 0)
+	return;
+    DEBUG(dbgFile, "Committing journal group " << sequence << ", "
+			<< numLogged << " sectors");
+
+    for (int i = 0; i < numLogged; i++)
+	kernel->bufferCache->ReadSector(home[i], &blocks[i * SectorSize]);
+    WriteLog(home, blocks, numLogged);
+    WriteRecord(numLogged);		// committed
+
+    WriteHome(home, blocks, numLogged);
+    WriteRecord(0);			// checkpointed
+    for (int i = 0; i < numLogged; i++)
+	kernel->bufferCache->Unpin(home[i]);
+
+    kernel->stats->numJournalCommits++;
+    kernel->stats->numJournalBlocks += numLogged;
+    sequence++;
+    numLogged = 0;
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteLog
+// 	Write a group to the journal area: the descriptor, then the
+//	logged sectors, in one request.  It doesn't count until the
+//	commit record says so.
+//
+//	"sectors" -- where each logged sector belongs
+//	"data" -- their contents, one after another
+//	"count" -- how many there are
+//----------------------------------------------------------------------
+
+void
+Journal::WriteLog(int *sectors, char *data, int count)
+{
+    int descriptor[JournalBlocks];
+    char *buffers[JournalBlocks + 1];
+
+    bzero(descriptor, sizeof(descriptor));
+    buffers[0] = (char *)descriptor;
+    for (int i = 0; i < count; i++) {
+	descriptor[i] = sectors[i];
+	buffers[i + 1] = &data[i * SectorSize];
+    }
+    synchDisk->WriteSectors(DescriptorSector, count + 1, buffers);
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteRecord
+// 	Write the commit record for the current group.
+//
+//	"numBlocks" -- how many sectors the group has; 0 if none of
+//		them needs replaying
+//----------------------------------------------------------------------
+
+void
+Journal::WriteRecord(int numBlocks)
+{
+    CommitRecord record;
+
+    bzero((char *)&record, sizeof(record));
+    record.magic = JournalMagic;
+    record.sequence = sequence;
+    record.numBlocks = numBlocks;
+    synchDisk->WriteSector(JournalSector, (char *)&record);
+}
+
+//----------------------------------------------------------------------
+// Journal::WriteHome
+// 	Write logged sectors to where they belong.  They are sorted
+//	first, so that each run of consecutive sectors is one request.
+//
+//	"sectors" -- where each one goes
+//	"data" -- their contents, one after another
+//	"count" -- how many there are
+//----------------------------------------------------------------------
+
+void
+Journal::WriteHome(int *sectors, char *data, int count)
+{
+    int order[JournalBlocks];
+    char *run[JournalBlocks];
+    int i, j, k;
+
+    for (i = 0; i < count; i++) {		// insertion sort, by sector
+	for (j = i; j > 0 && sectors[order[j - 1]] > sectors[i]; j--)
+	    order[j] = order[j - 1];
+	order[j] = i;
+    }
+    for (i = 0; i < count; i = j + 1) {
+	for (j = i; j + 1 < count &&
+		sectors[order[j + 1]] == sectors[order[j]] + 1; j++)
+	    ;
+	for (k = i; k <= j; k++)
+	    run[k - i] = &data[order[k] * SectorSize];
+	synchDisk->WriteSectors(sectors[order[i]], j - i + 1, run);
+    }
+}
+
+//----------------------------------------------------------------------
+// Journal::SelfTest
+// 	Test crash recovery, on a scratch disk of its own.  Commit a
+//	group, but stop before it is written home, as if Nachos crashed
+//	there: mounting the disk again must replay it.  Then write a
+//	group to the journal, but crash before its commit record: that
+//	one must be ignored.
+//----------------------------------------------------------------------
+
+#define TestDisk	"JOURNALTEST"
+#define TestBlocks	3
+
+static void
+CheckSectors(SynchDisk *disk, int *sectors, char *data)
+{
+    char sector[SectorSize];
+
+    for (int i = 0; i < TestBlocks; i++) {
+	disk->ReadSector(sectors[i], sector);
+	ASSERT(bcmp(sector, &data[i * SectorSize], SectorSize) == 0);
+    }
+}
+
+void
+Journal::SelfTest()
+{
+    SynchDisk *disk = new SynchDisk(TestDisk);
+    Journal *journal = new Journal(disk, JournalBlocks);
+    int sectors[TestBlocks] = { JournalSectors + 20, JournalSectors + 7, 
+				JournalSectors + 8 };	// out of order
+    char before[TestBlocks * SectorSize];
+    char committed[TestBlocks * SectorSize];
+    char uncommitted[TestBlocks * SectorSize];
+    int replays = kernel->stats->numJournalReplays;
+    int i;
+
+    memset(before, 'o', sizeof(before));
+    for (i = 0; i < (int) sizeof(committed); i++) {
+	committed[i] = 'a' + i % 26;
+	uncommitted[i] = 'A' + i % 26;
+    }
+    journal->Format();
+    for (i = 0; i < TestBlocks; i++)
+	disk->WriteSector(sectors[i], &before[i * SectorSize]);
+
+    // committed, then a crash before the home writes
+    journal->WriteLog(sectors, committed, TestBlocks);
+    journal->WriteRecord(TestBlocks);
+    CheckSectors(disk, sectors, before);
+    delete journal;			// nothing logged, so writes nothing
+
+    journal = new Journal(disk, JournalBlocks);
+    ASSERT(journal->Recover());
+    ASSERT(kernel->stats->numJournalReplays == replays + 1);
+    CheckSectors(disk, sectors, committed);
+
+    // a crash before the commit record
+    journal->WriteLog(sectors, uncommitted, TestBlocks);
+    delete journal;
+
+    journal = new Journal(disk, JournalBlocks);
+    ASSERT(journal->Recover());
+    ASSERT(kernel->stats->numJournalReplays == replays + 1);
+    CheckSectors(disk, sectors, committed);
+
+    delete journal;
+    delete disk;
+    Unlink(TestDisk);
+}
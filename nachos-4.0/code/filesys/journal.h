@@ -0,0 +1,115 @@
+// journal.h
+//	Data structures for a write-ahead journal of file system
+//	metadata: file headers (and their index blocks), directories,
+//	and the bitmap of free sectors.
+//
+//	A file system operation that changes metadata is a transaction:
+//	it calls Begin, Logs each metadata sector before writing it
+//	(through the buffer cache, as usual), and calls End.  A logged
+//	sector stays pinned in the buffer cache, so that its new
+//	contents can't reach the disk before the transaction commits.
+//
+//	Begin is told the most sectors the transaction can log, and
+//	only lets it in once the group has room for them all, so a
+//	transaction never finds the journal full half way through.  One
+//	that could log more than the whole journal holds is refused, and
+//	the operation fails with the disk untouched.
+//
+//	Transactions are committed in groups.  A group is written to
+//	the journal area of the disk in one sequential transfer, then a
+//	commit record makes it count; only then are the sectors written
+//	to their real homes.  If Nachos stops before that is done, the
+//	group is replayed (copied home again) the next time the disk is
+//	mounted.  A group that never got its commit record is lost, but
+//	the disk is left as it was before any of its transactions.
+//
+//	Only metadata is journaled.  The data in files is written as it
+//	always was, so a crash can leave a file with some of its new
+//	data and some of its old, but never a file system that needs
+//	to be re-formatted.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "copyright.h"
+#include "disk.h"
+
+// Where the journal lives on disk: a commit record, a descriptor
+// listing the home of each logged sector, and the logged sectors.
+
+#define JournalSector		2
+#define DescriptorSector	(JournalSector + 1)
+#define JournalBlocks		((int) (SectorSize / sizeof(int)))
+#define JournalSectors		(2 + JournalBlocks)
+
+#define JournalMagic		0x4a726e6c	// marks a formatted disk
+#define GroupCommitSize		8		// transactions per group
+
+class SynchDisk;
+class Lock;
+class Condition;
+
+// The commit record: a group is committed when this is written with
+// "numBlocks" non-zero, and checkpointed when it is written again
+// with "numBlocks" zero.
+
+class CommitRecord {
+  public:
+    int magic;				// JournalMagic
+    int sequence;			// which group this is
+    int numBlocks;			// how many sectors it logged
+    char unused[SectorSize - 3 * sizeof(int)];
+};
+
+// The following class defines the journal.
+
+class Journal {
+  public:
+    Journal(SynchDisk *disk, int maxBlocks);
+					// A journal of at most "maxBlocks"
+					// sectors per group (0 turns
+					// journaling off)
+    ~Journal();
+
+    void Format();			// Write an empty journal
+    bool Recover();			// Replay the last committed group,
+					// if it didn't get home; FALSE if
+					// the disk has no file system
+
+    bool Begin(int numBlocks);		// Start a transaction logging at
+					// most "numBlocks" sectors; FALSE
+					// if the journal can't hold them
+    void Log(int sector);		// "sector" is about to be written
+    void End(int numBlocks);		// Finish a transaction
+    void Flush();			// Commit whatever has been logged
+
+    static void SelfTest();		// Test crash recovery, on a
+					// scratch disk
+
+  private:
+    SynchDisk *synchDisk;		// where the journal lives
+    int capacity;			// most sectors in one group
+    int home[JournalBlocks];		// sectors logged in this group,
+    int numLogged;			// and how many of them
+    char *blocks;			// their contents, for the log
+    int numTransactions;		// transactions in this group
+    int numActive;			// ones not yet at End
+    int reserved;			// sectors they may still log
+    int sequence;			// number of the next group
+    Lock *lock;				// protects all of the above
+    Condition *idle;			// signalled when a transaction ends
+
+    bool GroupFull();			// Time to commit?
+    void Commit();			// Commit and checkpoint the group
+    void WriteLog(int *sectors, char *data, int count);
+					// Write a group to the journal area
+    void WriteRecord(int numBlocks);	// Write the commit record
+    void WriteHome(int *sectors, char *data, int count);
+					// Write logged sectors home
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,593 @@
+// logdisk.cc
+//	Routines to manage a log-structured disk: the sector map, the
+//	segment being filled, checkpoints, and the cleaner.
+//
+//	Physical sector numbers are kept as shorts in the map, and the
+//	segment of a physical sector is just its track.  A segment is
+//	clean (ready to be written), in use (it has live sectors, or is
+//	being filled), or freed (all its sectors are dead, but the
+//	checkpoint on disk may still point into it).
+//
+//	A lock makes each request atomic, and is held across the disk
+//	I/O, as in the buffer cache.  The cleaner holds it for a whole
+//	pass, so that no one else can take the segments it needs; a
+//	writer that finds only the cleaner's reserve left waits for it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "logdisk.h"
+#include "asyncdisk.h"
+#include "synch.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// LogCleaner
+// 	Start the cleaner thread.
+//----------------------------------------------------------------------
+
+static void
+LogCleaner(LogDisk *logDisk)
+{
+    logDisk->Cleaner();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::LogDisk
+// 	Initialize a log-structured disk.  Nothing is read or written
+//	until it is formatted or mounted.
+//
+//	"disk" -- the disk holding the log
+//----------------------------------------------------------------------
+
+LogDisk::LogDisk(AsyncDisk *disk)
+{
+    asyncDisk = disk;
+    map = new short[LogSectors];
+    segment = new char[SegmentSize * SectorSize];
+    summary = (SegmentSummary *) &segment[BlocksPerSegment * SectorSize];
+    victim = new char[SegmentSize * SectorSize];
+    mapBuffer = new char[MapSectors * SectorSize];
+    current = -1;
+    lastSegment = 0;
+    fill = 0;
+    segmentsWritten = 0;
+    checkpointSequence = 0;		// not formatted or mounted yet
+    cleaning = FALSE;
+    lock = new Lock("log disk lock");
+    cleanerWake = new Condition("log cleaner");
+    segmentFreed = new Condition("log segment freed");
+}
+
+//----------------------------------------------------------------------
+// LogDisk::~LogDisk
+// 	Write out everything, and de-allocate the log.  The cleaner
+//	thread is still asleep on "cleanerWake", so that and the lock
+//	are left alone.  A LogDisk that found no log on the disk never 
+//	writes anything.
+//----------------------------------------------------------------------
+
+LogDisk::~LogDisk()
+{
+    if (checkpointSequence > 0)
+	Flush();
+    delete [] map;
+    delete [] segment;
+    delete [] victim;
+    delete [] mapBuffer;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Format
+// 	Start an empty log: no logical sector has been written, and
+//	every segment is clean.  The summaries of old segments are wiped
+//	out, so they are never rolled forward, and so is the older
+//	checkpoint region.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Format()
+{
+    char zero[SectorSize];
+    int s;
+
+    DEBUG(dbgFile, "Formatting a log-structured disk.");
+    bzero(zero, SectorSize);
+    for (s = 0; s < LogSectors; s++)
+	map[s] = -1;
+    state[0] = SegInUse;			// the checkpoints
+    liveCount[0] = 0;
+    for (s = 1; s < NumSegments; s++) {
+	state[s] = SegClean;
+	liveCount[s] = 0;
+	Transfer(s * SegmentSize + BlocksPerSegment, 1, zero, TRUE);
+    }
+    numClean = NumSegments - 1;
+    numFreed = 0;
+    logSequence = 1;
+    checkpointSequence = 1;
+    checkpointRegion = 0;
+    Transfer(CheckpointRegion, 1, zero, TRUE);
+    lock->Acquire();
+    Checkpoint();
+    lock->Release();
+
+    Thread *t = new Thread("log cleaner");
+    t->Fork((VoidFunctionPtr) LogCleaner, (void *) this);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Mount
+// 	Read in the newer of the two checkpoints, and roll forward
+//	through the segments written since, in the order they were
+//	written.  Then write a new checkpoint, so that the segments freed
+//	along the way can be reused.  Return FALSE if there is no
+//	checkpoint: the disk isn't log-structured.
+//----------------------------------------------------------------------
+
+bool
+LogDisk::Mount()
+{
+    CheckpointHeader header[2];
+    char sector[SectorSize];
+    SegmentSummary *found = (SegmentSummary *) sector;
+    int order[NumSegments], sequence[NumSegments];
+    int r, s, i, j, numLater = 0;
+
+    for (r = 0; r < 2; r++) {
+	Transfer(r * CheckpointRegion, 1, sector, FALSE);
+	bcopy(sector, (char *) &header[r], sizeof(CheckpointHeader));
+    }
+    if (header[0].magic != LogMagic && header[1].magic != LogMagic)
+	return FALSE;
+    r = (header[1].magic != LogMagic || (header[0].magic == LogMagic &&
+		header[0].sequence > header[1].sequence)) ? 0 : 1;
+    DEBUG(dbgFile, "Mounting a log-structured disk, checkpoint "
+		<< header[r].sequence);
+    Transfer(r * CheckpointRegion + 1, MapSectors, mapBuffer, FALSE);
+    bcopy(mapBuffer, (char *) map, LogSectors * sizeof(short));
+    checkpointSequence = header[r].sequence + 1;
+    checkpointRegion = 1 - r;
+    logSequence = header[r].logSequence;
+
+    // find the segments written after the checkpoint, oldest first
+    for (s = 1; s < NumSegments; s++) {
+	Transfer(s * SegmentSize + BlocksPerSegment, 1, sector, FALSE);
+	if (found->sequence < header[r].logSequence)
+	    continue;
+	sequence[s] = found->sequence;
+	for (j = numLater; j > 0 && sequence[order[j - 1]] > sequence[s]; j--)
+	    order[j] = order[j - 1];
+	order[j] = s;
+	numLater++;
+    }
+    for (i = 0; i < numLater; i++) {
+	s = order[i];
+	Transfer(s * SegmentSize + BlocksPerSegment, 1, sector, FALSE);
+	DEBUG(dbgFile, "Rolling forward segment " << s << ", "
+		<< found->numBlocks << " sectors");
+	for (j = 0; j < found->numBlocks; j++)
+	    map[found->logical[j]] = s * SegmentSize + j;
+	logSequence = found->sequence + 1;
+	kernel->stats->numLogRollForwards++;
+    }
+
+    for (s = 0; s < NumSegments; s++)
+	liveCount[s] = 0;
+    for (i = 0; i < LogSectors; i++)
+	if (map[i] != -1)
+	    liveCount[map[i] / SegmentSize]++;
+    numClean = numFreed = 0;
+    state[0] = SegInUse;
+    for (s = 1; s < NumSegments; s++) {
+	state[s] = (liveCount[s] > 0) ? SegInUse : SegClean;
+	if (state[s] == SegClean)
+	    numClean++;
+    }
+    lock->Acquire();
+    Checkpoint();
+    lock->Release();
+
+    Thread *t = new Thread("log cleaner");
+    t->Fork((VoidFunctionPtr) LogCleaner, (void *) this);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::ReadSector
+// 	Read a logical sector: from the segment being filled, if it was
+//	written there, otherwise from wherever the map says it is.  A
+//	sector never written reads as zeroes.
+//----------------------------------------------------------------------
+
+void
+LogDisk::ReadSector(int sectorNumber, char *data)
+{
+    int physical;
+
+    ASSERT(sectorNumber >= 0 && sectorNumber < LogSectors);
+    lock->Acquire();
+    physical = map[sectorNumber];
+    if (physical == -1)
+	bzero(data, SectorSize);
+    else if (physical / SegmentSize == current)
+	bcopy(&segment[(physical % SegmentSize) * SectorSize], data,
+			SectorSize);
+    else
+	Transfer(physical, 1, data, FALSE);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::WriteSector
+// 	Write a logical sector, by appending it to the log.
+//----------------------------------------------------------------------
+
+void
+LogDisk::WriteSector(int sectorNumber, char *data)
+{
+    ASSERT(sectorNumber >= 0 && sectorNumber < LogSectors);
+    lock->Acquire();
+    Append(sectorNumber, data);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Flush
+// 	Write out the segment being filled, even if it isn't full, and
+//	a checkpoint, so that mounting the disk needn't roll forward.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Flush()
+{
+    lock->Acquire();
+    Seal();
+    Checkpoint();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Cleaner
+// 	The cleaner thread.  Sleep until clean segments run low, then
+//	make some more.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Cleaner()
+{
+    lock->Acquire();
+    for (;;) {
+	while (numClean >= CleanLowWater)
+	    cleanerWake->Wait(lock);
+	CleanPass();
+    }
+}
+
+//----------------------------------------------------------------------
+// LogDisk::CleanPass
+// 	Clean the emptiest segments in use until there are enough clean
+//	ones, as long as there is room in the log for what they hold;
+//	then checkpoint, to make the segments freed clean.  The caller
+//	holds the lock.
+//----------------------------------------------------------------------
+
+void
+LogDisk::CleanPass()
+{
+    int seg, room;
+
+    cleaning = TRUE;
+    if (numFreed > 0) {			// some just need a checkpoint
+	Seal();
+	Checkpoint();
+    }
+    while (numClean + numFreed < CleanHighWater) {
+	room = numClean * BlocksPerSegment;
+	if (current != -1)
+	    room += BlocksPerSegment - fill;
+	seg = PickVictim();
+	if (seg == -1 || liveCount[seg] > room)
+	    break;
+	Clean(seg);
+    }
+    Seal();
+    Checkpoint();
+    cleaning = FALSE;
+    segmentFreed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Append
+// 	Put a sector at the end of the log, and point the map at it.
+//	When the segment fills up, write it out.  The caller holds the
+//	lock.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Append(int sectorNumber, char *data)
+{
+    if (current == -1)
+	Open();
+    if (map[sectorNumber] != -1)
+	Kill(map[sectorNumber]);
+    bcopy(data, &segment[fill * SectorSize], SectorSize);
+    summary->logical[fill] = sectorNumber;
+    map[sectorNumber] = current * SegmentSize + fill;
+    liveCount[current]++;
+    fill++;
+    if (fill == BlocksPerSegment) {
+	Seal();
+	if (++segmentsWritten >= CheckpointInterval)
+	    Checkpoint();
+    }
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Kill
+// 	The copy of a sector at "physical" has been replaced.  If that
+//	leaves its segment empty, the segment is freed.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Kill(int physical)
+{
+    int seg = physical / SegmentSize;
+
+    ASSERT(liveCount[seg] > 0);
+    if (--liveCount[seg] == 0 && seg != current) {
+	state[seg] = SegFreed;
+	numFreed++;
+    }
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Open
+// 	Start filling a clean segment.  We take the next one after the
+//	segment last written, so the log sweeps across the disk.  If
+//	only the cleaner's reserve is left, wake it and wait for it --
+//	unless we are the cleaner.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Open()
+{
+    int s;
+
+    while (!cleaning && numClean <= ReserveSegments) {
+	cleanerWake->Signal(lock);
+	segmentFreed->Wait(lock);
+    }
+    if (numClean < CleanLowWater)
+	cleanerWake->Signal(lock);
+    ASSERT(numClean > 0);
+    for (s = lastSegment % (NumSegments - 1) + 1; state[s] != SegClean;
+			s = s % (NumSegments - 1) + 1)
+	;
+    lastSegment = s;
+    state[s] = SegInUse;
+    numClean--;
+    current = s;
+    fill = 0;
+    bzero((char *) summary, SectorSize);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Seal
+// 	Write the segment being filled to disk, as one full track, with
+//	its summary last.  Nothing is left being filled.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Seal()
+{
+    if (current == -1)
+	return;
+    summary->sequence = logSequence++;
+    summary->numBlocks = fill;
+    DEBUG(dbgFile, "Writing segment " << current << ", " << fill
+		<< " sectors, sequence " << summary->sequence);
+    Transfer(current * SegmentSize, SegmentSize, segment, TRUE);
+    kernel->stats->numLogSegments++;
+    if (liveCount[current] == 0) {	// all overwritten already
+	state[current] = SegFreed;
+	numFreed++;
+    }
+    current = -1;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Checkpoint
+// 	Write the map to the next checkpoint region, then its header.
+//	Segments freed since the last checkpoint are clean from now on.
+//	Nothing may be being filled.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Checkpoint()
+{
+    char sector[SectorSize];
+    CheckpointHeader *header = (CheckpointHeader *) sector;
+    int base = checkpointRegion * CheckpointRegion;
+
+    ASSERT(current == -1);
+    bzero(mapBuffer, MapSectors * SectorSize);
+    bcopy((char *) map, mapBuffer, LogSectors * sizeof(short));
+    Transfer(base + 1, MapSectors, mapBuffer, TRUE);
+    bzero(sector, SectorSize);
+    header->magic = LogMagic;
+    header->sequence = checkpointSequence++;
+    header->logSequence = logSequence;
+    Transfer(base, 1, sector, TRUE);
+    kernel->stats->numLogCheckpoints++;
+
+    checkpointRegion = 1 - checkpointRegion;
+    segmentsWritten = 0;
+    for (int s = 1; s < NumSegments; s++) {
+	if (state[s] == SegFreed) {
+	    state[s] = SegClean;
+	    numClean++;
+	}
+    }
+    numFreed = 0;
+    segmentFreed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// LogDisk::PickVictim
+// 	Return the segment in use with the fewest live sectors, or -1 if
+//	every one is full of them.
+//----------------------------------------------------------------------
+
+int
+LogDisk::PickVictim()
+{
+    int best = -1;
+
+    for (int s = 1; s < NumSegments; s++) {
+	if (state[s] == SegInUse && s != current &&
+		liveCount[s] < BlocksPerSegment &&
+		(best == -1 || liveCount[s] < liveCount[best]))
+	    best = s;
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Clean
+// 	Read segment "seg", and append the sectors in it that are still
+//	live to the log.  That leaves it freed.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Clean(int seg)
+{
+    SegmentSummary *old = (SegmentSummary *) &victim[BlocksPerSegment * SectorSize];
+
+    DEBUG(dbgFile, "Cleaning segment " << seg << ", " << liveCount[seg]
+		<< " live sectors");
+    Transfer(seg * SegmentSize, SegmentSize, victim, FALSE);
+    for (int i = 0; i < old->numBlocks; i++) {
+	if (map[old->logical[i]] == seg * SegmentSize + i)
+	    Append(old->logical[i], &victim[i * SectorSize]);
+    }
+    ASSERT(liveCount[seg] == 0);
+    kernel->stats->numLogCleaned++;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::Transfer
+// 	Read or write "count" consecutive physical sectors, from or to
+//	consecutive memory, as one request; wait for it to finish.
+//----------------------------------------------------------------------
+
+void
+LogDisk::Transfer(int sectorNumber, int count, char *data, bool write)
+{
+    char **buffers = new char *[count];
+    DiskRequest *request;
+
+    for (int i = 0; i < count; i++)
+	buffers[i] = &data[i * SectorSize];
+    request = new DiskRequest(sectorNumber, count, buffers, write);
+    request->done = new Semaphore("log disk", 0);
+    asyncDisk->Submit(request);
+    request->done->P();
+    delete request->done;
+    delete request;
+    delete [] buffers;
+}
+
+//----------------------------------------------------------------------
+// LogDisk::SelfTest
+// 	Test the cleaner and roll-forward, on a scratch disk of its own.
+//
+//	Each of a few hundred "cold" sectors is written once, with the
+//	same few "hot" sectors written over in between, so that every
+//	segment is left holding a handful of live sectors: the log fills
+//	up, and only the cleaner can make room.  Then, after a
+//	checkpoint, some cold sectors are written again, and their
+//	segments written out, but Nachos "crashes" before the next
+//	checkpoint.  Mounting the disk again must roll forward and find
+//	every sector where it was last written.
+//----------------------------------------------------------------------
+
+#define TestDisk	"LOGTEST"
+#define HotSectors	10
+#define ColdSectors	150
+#define MovedSectors	(2 * BlocksPerSegment + 5)
+
+static void
+TestData(char *data, int sector, int version)
+{
+    bzero(data, SectorSize);
+    ((int *) data)[0] = sector;
+    ((int *) data)[1] = version;
+}
+
+static void
+TestWrite(LogDisk *log, int sector, int *version)
+{
+    char data[SectorSize];
+
+    TestData(data, sector, ++version[sector]);
+    log->WriteSector(sector, data);
+}
+
+void
+LogDisk::SelfTest()
+{
+    AsyncDisk *disk = new AsyncDisk(TestDisk);
+    LogDisk *log = new LogDisk(disk);
+    int version[LogSectors];		// last written, or -1
+    short *where = new short[LogSectors];
+    char data[SectorSize], expected[SectorSize];
+    int cleaned = kernel->stats->numLogCleaned;
+    int rolled = kernel->stats->numLogRollForwards;
+    int s, i;
+
+    log->Format();
+    for (s = 0; s < LogSectors; s++)
+	version[s] = -1;
+    for (i = 0; i < ColdSectors; i++) {
+	TestWrite(log, HotSectors + i, version);
+	for (s = 0; s < HotSectors; s++)
+	    TestWrite(log, s, version);
+    }
+    ASSERT(kernel->stats->numLogCleaned > cleaned);
+
+    // a checkpoint, leaving enough clean segments that the cleaner
+    // won't take another before the crash
+    log->lock->Acquire();
+    log->CleanPass();
+    ASSERT(log->numClean >= CleanHighWater);
+    log->lock->Release();
+    for (i = 0; i < MovedSectors; i++)
+	TestWrite(log, HotSectors + i, version);
+    log->lock->Acquire();
+    log->Seal();
+    bcopy((char *) log->map, (char *) where, LogSectors * sizeof(short));
+    log->lock->Release();
+    log->checkpointSequence = 0;	// crash: the log isn't flushed
+    delete log;
+
+    log = new LogDisk(disk);
+    ASSERT(log->Mount());
+    ASSERT(kernel->stats->numLogRollForwards > rolled);
+    for (s = 0; s < LogSectors; s++)	// before the cleaner can run
+	ASSERT(log->map[s] == where[s]);
+    for (s = 0; s < LogSectors; s++) {
+	if (version[s] == -1)
+	    continue;
+	log->ReadSector(s, data);
+	TestData(expected, s, version[s]);
+	ASSERT(bcmp(data, expected, SectorSize) == 0);
+    }
+
+    delete log;
+    delete disk;
+    delete [] where;
+    Unlink(TestDisk);
+}
@@ -0,0 +1,149 @@
+// logdisk.h
+//	Data structures for a log-structured layout of the disk.
+//
+//	The file system asks for sectors by number, as always, but on a
+//	log-structured disk those numbers are "logical": the sector map
+//	(the LFS inode map, done a sector at a time) says where each one
+//	is really stored.  Writing a sector never overwrites it in
+//	place; the new contents are appended to the segment being
+//	filled in memory, and the map updated.  A segment is one track,
+//	and is written to disk all at once, when it is full -- so every
+//	write the disk sees is a full-track append, with no seeking in
+//	between.
+//
+//	The last sector of each segment is its summary: which logical
+//	sector each of the others holds.  The map itself is saved in a
+//	checkpoint, every few segments.  To mount the disk, we read the
+//	newest checkpoint, and then roll forward through the segments
+//	written after it, using their summaries.
+//
+//	Overwritten sectors leave dead space behind in older segments.
+//	A cleaner thread gathers the live sectors of the emptiest
+//	segments, appends them to the log again, and so frees whole
+//	segments to be written.  A freed segment isn't reused until the
+//	next checkpoint, since the one on disk may still point into it.
+//
+//	The layout is chosen when the disk is formatted ("-lfs"); a disk
+//	formatted that way is recognized from its checkpoint.  Only
+//	LogSectors of the disk's sectors can be used, leaving room in
+//	the log for the cleaner to work.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef LOGDISK_H
+#define LOGDISK_H
+
+#include "copyright.h"
+#include "disk.h"
+
+#define SegmentSize		SectorsPerTrack	// sectors in a segment
+#define NumSegments		(NumSectors / SegmentSize)
+#define BlocksPerSegment	(SegmentSize - 1)	// the last is the
+							// summary
+#define LogSectors		(NumSectors * 2 / 3)	// logical sectors
+
+// Segment 0 holds two checkpoint regions, written in turn, so that
+// one of them is always whole.  Each is a header followed by the map.
+
+#define CheckpointRegion	(SegmentSize / 2)	// sectors in each
+#define MapSectors		divRoundUp(LogSectors * sizeof(short), SectorSize)
+
+#define LogMagic		0x4c6f6753	// marks a checkpoint
+#define CheckpointInterval	8	// segments between checkpoints
+#define CleanLowWater		4	// wake the cleaner below this many
+					// clean segments
+#define CleanHighWater		8	// it cleans up to this many
+#define ReserveSegments		2	// kept for the cleaner: others wait
+
+class AsyncDisk;
+class Lock;
+class Condition;
+
+// The summary of a segment.
+
+class SegmentSummary {
+  public:
+    int sequence;			// segments are numbered as they are
+					// written; 0 means never written
+    int numBlocks;			// sectors filled in
+    short logical[BlocksPerSegment];	// what each of them holds
+};
+
+// The header of a checkpoint.
+
+class CheckpointHeader {
+  public:
+    int magic;				// LogMagic, if the checkpoint is whole
+    int sequence;			// the newer checkpoint wins
+    int logSequence;			// segments numbered from here on
+					// were written after it
+};
+
+// What a segment is being used for.
+
+enum SegmentState { SegClean, SegInUse, SegFreed };
+
+// The following class defines the log-structured disk.
+
+class LogDisk {
+  public:
+    LogDisk(AsyncDisk *disk);		// A log on "disk"
+    ~LogDisk();				// Flush, then de-allocate
+
+    void Format();			// Start an empty log
+    bool Mount();			// Read the map back in; FALSE if the
+					// disk isn't log-structured
+
+    void ReadSector(int sectorNumber, char *data);
+    void WriteSector(int sectorNumber, char *data);
+					// Read/write a logical sector
+    void Flush();			// Write out the segment being filled,
+					// and a checkpoint
+
+    void Cleaner();			// Body of the cleaner thread
+
+    static void SelfTest();		// Test the cleaner and roll-forward,
+					// on a scratch disk
+
+  private:
+    AsyncDisk *asyncDisk;		// where the log really lives
+    short *map;				// where each logical sector is, or -1
+    int liveCount[NumSegments];		// live sectors in each segment
+    SegmentState state[NumSegments];
+    int numClean;			// segments ready to be written
+    int numFreed;			// ones waiting for a checkpoint
+
+    int current;			// segment being filled, or -1
+    int lastSegment;			// the one filled before it
+    int fill;				// sectors filled in it
+    char *segment;			// its contents
+    SegmentSummary *summary;		// and its summary
+    int logSequence;			// number of the next segment
+    int segmentsWritten;		// since the last checkpoint
+
+    int checkpointSequence;		// number of the next checkpoint
+    int checkpointRegion;		// where it goes: 0 or 1
+    char *mapBuffer;			// the map, as written to disk
+
+    bool cleaning;			// is the cleaner at work?
+    char *victim;			// segment it is cleaning
+    Lock *lock;				// one request at a time
+    Condition *cleanerWake;		// wakes the cleaner
+    Condition *segmentFreed;		// wakes writers waiting for space
+
+    void Append(int sectorNumber, char *data);
+					// Put a sector at the end of the log
+    void Kill(int physical);		// An old copy of a sector is dead
+    void Open();			// Start filling a clean segment
+    void Seal();			// Write the segment being filled
+    void Checkpoint();			// Write the map, free what we can
+    void CleanPass();			// Free some segments
+    int PickVictim();			// The emptiest segment
+    void Clean(int seg);		// Move its live sectors to the log
+    void Transfer(int sectorNumber, int count, char *data, bool write);
+					// Read/write consecutive sectors
+};
+
+#endif // LOGDISK_H
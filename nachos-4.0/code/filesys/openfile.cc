@@ -5,7 +5,15 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  All the OpenFiles of one file
+//	share the same copy of its header (cf. hdrcache.h).
+//
+//	Each OpenFile watches for sequential access: a ReadAt/WriteAt
+//	that starts where the last one stopped.  A sequential reader
+//	gets the next few sectors read in ahead of time, and a 
+//	sequential writer has each batch of sectors it fills written
+//	out together, in both cases without waiting for the disk, so
+//	the I/O overlaps with whatever the thread does next.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,32 +24,37 @@
 #include "copyright.h"
 #include "filehdr.h"
 #include "openfile.h"
+#include "synch.h"
 #include "debug.h"
 #include "main.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is open already.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    hdr = kernel->headerCache->Acquire(sector);
+    hdrSector = sector;
+    fileLock = kernel->headerCache->LockOf(hdr);
     seekPosition = 0;
+    journaled = FALSE;
+    lastEnd = readAhead = writeBehind = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The file header goes too, if this was the last open of the file.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    kernel->headerCache->Release(hdr);
 }
 
 //----------------------------------------------------------------------
@@ -95,16 +108,19 @@ OpenFile::Write(char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  So we go through the buffer cache a sector at
+//	a time, asking for just the part of each sector that is in the
+//	request.  The bytes move straight between the cached sector and 
+//	the caller's buffer -- no buffer of our own -- and the cache 
+//	takes care of reading in a sector that is only partly written.
+//
+//	A write that runs past the end of the file grows the file first,
+//	if there is room on the disk (metadata files excepted: they are
+//	grown by the file system itself).  One that starts past the end
+//	writes nothing.
 //
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	A read holds the file's lock shared with other readers; a write
+//	holds it alone.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -116,71 +132,118 @@ OpenFile::Write(char *into, int numBytes)
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
-    int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int fileLength;
+    int i, firstSector, lastSector, start, end;
+    bool sequential = (position == lastEnd);
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    fileLock->ReadAcquire();
+    fileLength = hdr->FileLength();
+    if ((numBytes <= 0) || (position >= fileLength)) {
+	fileLock->ReadRelease();
     	return 0; 				// check request
+    }
     if ((position + numBytes) > fileLength)		
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Reading " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    // read the part of each sector that we want
+    for (i = firstSector; i <= lastSector; i++) {
+	start = max(position, i * SectorSize);
+	end = min(position + numBytes, (i + 1) * SectorSize);
+        kernel->bufferCache->ReadPartial(hdr->ByteToSector(i * SectorSize), 
+			&into[start - position], start - i * SectorSize, end - start);
+    }
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    // read ahead of a sequential reader, once half of what was read
+    // ahead last time is used up
+    lastEnd = position + numBytes;
+    if (!sequential)
+	readAhead = lastEnd;
+    else if (readAhead - lastEnd < ReadAheadSectors * SectorSize / 2) {
+	end = min(lastEnd + ReadAheadSectors * SectorSize, fileLength);
+	StartTransfers(max(readAhead, lastEnd), end, FALSE);
+	readAhead = max(readAhead, end);
+    }
+    fileLock->ReadRelease();
     return numBytes;
 }
 
 int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
-    int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int fileLength;
+    int i, firstSector, lastSector, start, end;
+    bool sequential = (position == lastEnd);
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    fileLock->WriteAcquire();
+    fileLength = hdr->FileLength();
+    if (numBytes > 0 && position <= fileLength && !journaled &&
+	    position + numBytes > fileLength &&
+	    kernel->fileSystem->Extend(hdr, hdrSector, position + numBytes))
+	fileLength = hdr->FileLength();
+    if ((numBytes <= 0) || (position >= fileLength)) {
+	fileLock->WriteRelease();
 	return 0;				// check request
+    }
     if ((position + numBytes) > fileLength)
 	numBytes = fileLength - position;
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    buf = new char[numSectors * SectorSize];
+    // write the part of each sector that we change
+    for (i = firstSector; i <= lastSector; i++) {
+	start = max(position, i * SectorSize);
+	end = min(position + numBytes, (i + 1) * SectorSize);
+	if (journaled)
+	    kernel->journal->Log(hdr->ByteToSector(i * SectorSize));
+        kernel->bufferCache->WritePartial(hdr->ByteToSector(i * SectorSize), 
+			&from[start - position], start - i * SectorSize, end - start);
+    }
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    // write out the sectors filled so far, once there are enough of them
+    lastEnd = position + numBytes;
+    if (!sequential)
+	writeBehind = firstSector * SectorSize;
+    end = divRoundDown(lastEnd, SectorSize) * SectorSize;
+    if (end - writeBehind >= WriteBehindSectors * SectorSize) {
+	StartTransfers(writeBehind, end, TRUE);
+	writeBehind = end;
+    }
+    fileLock->WriteRelease();
+    return numBytes;
+}
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+//----------------------------------------------------------------------
+// OpenFile::StartTransfers
+// 	Start reading in (or writing out) the sectors holding bytes
+//	"from" to "to - 1" of the file, without waiting for them.  The
+//	sectors are handed to the buffer cache a run of consecutive 
+//	disk sectors at a time, so that each run is one disk request.
+//
+//	"from", "to" -- the range of bytes in the file
+//	"write" -- TRUE to write the sectors out, FALSE to read them in
+//----------------------------------------------------------------------
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+void
+OpenFile::StartTransfers(int from, int to, bool write)
+{
+    int offset = divRoundDown(from, SectorSize) * SectorSize;
+    int count;
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+    while (offset < to) {
+	count = min(hdr->ContiguousSectors(offset), 
+			divRoundUp(to - offset, SectorSize));
+	if (write)
+	    kernel->bufferCache->WriteBehind(hdr->ByteToSector(offset), count);
+	else
+	    kernel->bufferCache->Prefetch(hdr->ByteToSector(offset), count);
+	offset += count * SectorSize;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -191,6 +254,11 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
 int
 OpenFile::Length() 
 { 
-    return hdr->FileLength(); 
+    int length;
+
+    fileLock->ReadAcquire();
+    length = hdr->FileLength();
+    fileLock->ReadRelease();
+    return length;
 }
 #endif //FILESYS
@@ -9,9 +9,11 @@
 //
 //	The other is the "real" implementation, that turns these
 //	operations into read and write disk sector requests. 
-//	In this baseline implementation of the file system, we don't 
-//	worry about concurrent accesses to the file system
-//	by different threads -- this is part of the assignment.
+//	Any number of threads may read a file at once, but a write
+//	has the file to itself, so that no one sees it half done.
+//	An OpenFile's position in the file (and the rest of its own
+//	state) isn't protected: threads sharing one OpenFile have to
+//	take turns themselves.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -32,12 +34,10 @@ class OpenFile {
     ~OpenFile() { Close(file); }			// close the file
 
     int ReadAt(char *into, int numBytes, int position) { 
-    		Lseek(file, position, 0); 
-		return ReadPartial(file, into, numBytes); 
+		return PReadPartial(file, into, numBytes, position); 
 		}	
     int WriteAt(char *from, int numBytes, int position) { 
-    		Lseek(file, position, 0); 
-		WriteFile(file, from, numBytes); 
+		PWrite(file, from, numBytes, position); 
 		return numBytes;
 		}	
     int Read(char *into, int numBytes) {
@@ -60,6 +60,13 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class RWLock;
+
+#define ReadAheadSectors	16	// how far ahead of a sequential
+					// reader to read
+#define WriteBehindSectors	8	// how many sectors a sequential 
+					// writer fills before they are 
+					// written out
 
 class OpenFile {
   public:
@@ -85,10 +92,29 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    void JournalWrites() { journaled = TRUE; }
+					// The file holds metadata: log
+					// every write in the journal
     
   private:
-    FileHeader *hdr;			// Header for this file 
+    FileHeader *hdr;			// Header for this file, shared
+					// with other opens of the file
+    RWLock *fileLock;			// Readers/writer lock on the file,
+					// shared the same way
+    int hdrSector;			// Where the header lives on disk
     int seekPosition;			// Current position within the file
+    bool journaled;			// Writes go through the journal?
+
+    int lastEnd;			// Where the last ReadAt/WriteAt
+					// stopped: the next one is 
+					// sequential if it starts here
+    int readAhead;			// Prefetched up to here
+    int writeBehind;			// Written out up to here
+
+    void StartTransfers(int from, int to, bool write);
+					// Prefetch or write behind the
+					// sectors holding these bytes
 };
 
 #endif // FILESYS
@@ -8,6 +8,7 @@
 
 #include "copyright.h"
 #include "pbitmap.h"
+#include "sysdep.h"
 
 //----------------------------------------------------------------------
 // PersistBitMap::PersistBitMap
@@ -19,6 +20,8 @@
 
 PersistBitMap::PersistBitMap(int numItems):BitMap(numItems) 
 { 
+    onDisk = new unsigned int[numWords];
+    allDirty = TRUE;
 }
 
 PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
@@ -26,7 +29,8 @@ PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    onDisk = new unsigned int[numWords];
+    FetchFrom(file);
 }
 //----------------------------------------------------------------------
 // BitMap::~BitMap
@@ -35,6 +39,7 @@ PersistBitMap::PersistBitMap(OpenFile *file, int numItems):BitMap(numItems)
 
 PersistBitMap::~PersistBitMap()
 { 
+    delete [] onDisk;
 }
 
 
@@ -49,11 +54,14 @@ void
 PersistBitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    bcopy(map, onDisk, numWords * sizeof(unsigned));
+    allDirty = FALSE;
 }
 
 //----------------------------------------------------------------------
 // BitMap::WriteBack
-// 	Store the contents of a bitmap to a Nachos file.
+// 	Store the contents of a bitmap to a Nachos file.  Only the range
+//	of words that differ from what is on disk is written.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -61,5 +69,18 @@ PersistBitMap::FetchFrom(OpenFile *file)
 void
 PersistBitMap::WriteBack(OpenFile *file)
 {
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    int first = 0, last = numWords - 1;
+
+    if (!allDirty) {
+	while (first < numWords && map[first] == onDisk[first])
+	    first++;
+	if (first == numWords)
+	    return;			// nothing changed
+	while (map[last] == onDisk[last])
+	    last--;
+    }
+    file->WriteAt((char *)&map[first], (last - first + 1) * sizeof(unsigned),
+			first * sizeof(unsigned));
+    bcopy(&map[first], &onDisk[first], (last - first + 1) * sizeof(unsigned));
+    allDirty = FALSE;
 }
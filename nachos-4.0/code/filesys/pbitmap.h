@@ -16,6 +16,9 @@
 // The following class defines a persistent bitmap.  It inherits all
 // the behavior of a bitmap (see bitmap.h), adding the ability to
 // be read from and stored to the disk.
+//
+// The bitmap remembers what it last read or wrote, so WriteBack only
+// has to write the words that have changed since.
 
 class PersistBitMap : public BitMap {
   public:
@@ -23,7 +26,12 @@ class PersistBitMap : public BitMap {
     PersistBitMap(int numItems);
     ~PersistBitMap(); 			// deallocate bitmap
     void FetchFrom(OpenFile *file);
-    void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+    void WriteBack(OpenFile *file); 	// write changed bitmap contents
+					// to disk 
+
+  private:
+    unsigned int *onDisk;		// the words as they are on disk
+    bool allDirty;			// nothing on disk yet
 };
 
 #endif // PBITMAP_H
@@ -5,10 +5,13 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Each request has a semaphore to synchronize the interrupt
+//	handler with the thread waiting for it.  The AsyncDisk below us
+//	takes care of the physical disk only doing one operation at a
+//	time.
+//
+//	On a log-structured disk (cf. logdisk.h), sector numbers are 
+//	logical, so every request is handed to the LogDisk instead.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,7 +19,10 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
-
+#ifdef FILESYS
+#include "logdisk.h"
+#endif
+#include "main.h"
 
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
@@ -29,9 +35,10 @@
 
 SynchDisk::SynchDisk(char* name)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
-    disk = new Disk(name, this);
+    asyncDisk = new AsyncDisk(name);
+#ifdef FILESYS
+    logDisk = NULL;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -42,9 +49,7 @@ SynchDisk::SynchDisk(char* name)
 
 SynchDisk::~SynchDisk()
 {
-    delete disk;
-    delete lock;
-    delete semaphore;
+    delete asyncDisk;
 }
 
 //----------------------------------------------------------------------
@@ -59,10 +64,15 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskRequest request(sectorNumber, data, FALSE);
+
+#ifdef FILESYS
+    if (logDisk != NULL) {
+	logDisk->ReadSector(sectorNumber, data);
+	return;
+    }
+#endif
+    Wait(&request);
 }
 
 //----------------------------------------------------------------------
@@ -77,20 +87,70 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskRequest request(sectorNumber, data, TRUE);
+
+#ifdef FILESYS
+    if (logDisk != NULL) {
+	logDisk->WriteSector(sectorNumber, data);
+	return;
+    }
+#endif
+    Wait(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write a run of consecutive disk sectors, as one request.
+//	Return only after all of them have been transferred.
+//
+//	"firstSector" -- the first disk sector of the run
+//	"count" -- the number of sectors
+//	"buffers" -- the memory for each sector
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int firstSector, int count, char **buffers)
+{
+    DiskRequest request(firstSector, count, buffers, FALSE);
+
+#ifdef FILESYS
+    if (logDisk != NULL) {
+	for (int i = 0; i < count; i++)
+	    logDisk->ReadSector(firstSector + i, buffers[i]);
+	return;
+    }
+#endif
+    Wait(&request);
+}
+
+void
+SynchDisk::WriteSectors(int firstSector, int count, char **buffers)
+{
+    DiskRequest request(firstSector, count, buffers, TRUE);
+
+#ifdef FILESYS
+    if (logDisk != NULL) {
+	for (int i = 0; i < count; i++)
+	    logDisk->WriteSector(firstSector + i, buffers[i]);
+	return;
+    }
+#endif
+    Wait(&request);
 }
 
 //----------------------------------------------------------------------
-// SynchDisk::CallBack
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// SynchDisk::Wait
+// 	Submit a request to the asynchronous disk, and wait for the 
+//	interrupt handler to tell us it is done.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::CallBack()
-{ 
-    semaphore->V();
+SynchDisk::Wait(DiskRequest *request)
+{
+    Semaphore *done = new Semaphore("synch disk", 0);
+
+    request->done = done;
+    asyncDisk->Submit(request);
+    done->P();				// wait for interrupt
+    delete done;
 }
@@ -12,21 +12,21 @@
 #include "copyright.h"
 #include "disk.h"
 #include "synch.h"
-#include "callback.h"
+#include "asyncdisk.h"
+
+class LogDisk;
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
 // and an interrupt occurs later to signal that the operation completed.
-// (Also, the physical characteristics of the disk device assume that
-// only one operation can be requested at a time).
 //
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
-// returning.
-class Semaphore;
-class Lock;
-class SynchDisk : public CallBackObj {
+// returning.  It is a thin layer over AsyncDisk, which queues and
+// schedules the requests of all threads; code that does not want to
+// wait can use "asyncDisk" directly.
+class SynchDisk {
   public:
     SynchDisk(char* name);    		// Initialize a synchronous disk,
 					// by initializing the raw Disk.
@@ -35,21 +35,25 @@ class SynchDisk : public CallBackObj {
     void ReadSector(int sectorNumber, char* data);
     					// Read/write a disk sector, returning
     					// only once the data is actually read 
-					// or written.  These call
-    					// Disk::ReadRequest/WriteRequest and
-					// then wait until the request is done.
+					// or written.  These submit a request
+					// to the AsyncDisk and then wait 
+					// until the request is done.
     void WriteSector(int sectorNumber, char* data);
-    
-    void CallBack();			// Called by the disk device interrupt
-					// handler, to signal that the
-					// current disk operation is complete.
+
+    void ReadSectors(int firstSector, int count, char **buffers);
+    void WriteSectors(int firstSector, int count, char **buffers);
+					// Read/write "count" consecutive
+					// sectors, each with its own buffer
+
+    AsyncDisk *asyncDisk;		// The underlying asynchronous disk
+#ifdef FILESYS
+    LogDisk *logDisk;			// If not NULL, the disk is log-
+					// structured, and every request
+					// goes through it
+#endif
 
   private:
-    Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    void Wait(DiskRequest *request);	// Submit a request and wait for it
 };
 
 #endif // SYNCHDISK_H
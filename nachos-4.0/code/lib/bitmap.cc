@@ -28,11 +28,9 @@ BitMap::BitMap(int numItems)
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
     for (i = 0; i < numWords; i++) {
-	map[i] = 0;		// initialize map to keep Purify happy
-    }
-    for (i = 0; i < numBits; i++) {
-        Clear(i);
-    }
+	map[i] = 0;		// every bit clear, including the unused
+    }				// ones at the end of the last word
+    cursor = 0;
 }
 
 //----------------------------------------------------------------------
@@ -42,7 +40,7 @@ BitMap::BitMap(int numItems)
 
 BitMap::~BitMap()
 { 
-    delete map;
+    delete [] map;
 }
 
 //----------------------------------------------------------------------
@@ -98,31 +96,91 @@ BitMap::Test(int which) const
     }
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextClear
+// 	Return the number of the first clear bit at or after "from",
+//	or numBits if there is none.  Whole words of set bits are
+//	skipped at once; within a word, the lowest clear bit is found
+//	by counting trailing zeroes of the complement.
+//
+//	"from" is the number of the bit to start looking at.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int from) const
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = ~map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = ~map[w];
+    }
+    return min(w * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
+//----------------------------------------------------------------------
+// BitMap::NextSet
+// 	Return the number of the first set bit at or after "from",
+//	or numBits if there is none.
+//
+//	"from" is the number of the bit to start looking at.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextSet(int from) const
+{
+    int w = from / BitsInWord;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    bits = map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = map[w];
+    }
+    return min(w * BitsInWord + __builtin_ctz(bits), numBits);
+}
+
 //----------------------------------------------------------------------
 // BitMap::FindAndSet
-// 	Return the number of the first bit which is clear.
+// 	Return the number of a bit which is clear.
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	The search starts just after the bit handed out last time
+//	("next fit"), and wraps around, so that bits at the front
+//	that have been allocated for a long time aren't tested over 
+//	and over again.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 BitMap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
+    int which = FindRun(1, cursor);
+
+    if (which != -1) {
+	Mark(which);
+	cursor = (which + 1) % numBits;
     }
-    return -1;
+    return which;
 }
 
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//
+//	The unused bits at the end of the last word are always clear,
+//	so counting the set bits a word at a time gives the answer.
 //----------------------------------------------------------------------
 
 int 
@@ -130,12 +188,130 @@ BitMap::NumClear() const
 {
     int count = 0;
 
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
+    for (int w = 0; w < numWords; w++) {
+	count += __builtin_popcount(map[w]);
+    }
+    return numBits - count;
+}
+
+//----------------------------------------------------------------------
+// BitMap::MarkRange
+// 	Set "count" bits in a row, starting with bit "first".
+//	Whole words are set at once.
+//----------------------------------------------------------------------
+
+void
+BitMap::MarkRange(int first, int count)
+{
+    int i = first, last = first + count;
+
+    ASSERT(first >= 0 && count >= 0 && last <= numBits);
+
+    while (i < last) {
+	if (i % BitsInWord == 0 && last - i >= BitsInWord) {
+	    map[i / BitsInWord] = ~0u;
+	    i += BitsInWord;
+	} else {
+	    map[i / BitsInWord] |= 1u << (i % BitsInWord);
+	    i++;
 	}
     }
-    return count;
+}
+
+//----------------------------------------------------------------------
+// BitMap::ClearRange
+// 	Clear "count" bits in a row, starting with bit "first".
+//----------------------------------------------------------------------
+
+void
+BitMap::ClearRange(int first, int count)
+{
+    int i = first, last = first + count;
+
+    ASSERT(first >= 0 && count >= 0 && last <= numBits);
+
+    while (i < last) {
+	if (i % BitsInWord == 0 && last - i >= BitsInWord) {
+	    map[i / BitsInWord] = 0;
+	    i += BitsInWord;
+	} else {
+	    map[i / BitsInWord] &= ~(1u << (i % BitsInWord));
+	    i++;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Return the number of the first bit of a run of "count" clear
+//	bits, searching from bit "start" to the end of the map and then
+//	from the front.  A run does not wrap around the end of the map.
+//
+//	If there is no run that long, return -1 -- unless "length" is
+//	given, in which case settle for the longest run there is 
+//	(-1 only if every bit is set).  "*length" is set to the length
+//	of the run returned.
+//
+//	Runs are found by alternating NextClear and NextSet, so the
+//	cost depends on the number of runs, not the number of bits.
+//
+//	"count" is the number of clear bits wanted
+//	"start" is the bit to start looking at
+//	"length" is where to return the length of the run found
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count, int start, int *length) const
+{
+    int bestStart = -1, bestLength = 0;
+    int which, end, limit;
+
+    ASSERT(count > 0);
+    if (start < 0 || start >= numBits)
+	start = 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+	which = NextClear(pass == 0 ? start : 0);
+	limit = (pass == 0) ? numBits : start;
+	while (which < limit) {
+	    end = NextSet(which);
+	    if (end - which >= count) {
+		bestStart = which;
+		bestLength = count;
+		break;
+	    }
+	    if (end - which > bestLength) {
+		bestStart = which;
+		bestLength = end - which;
+	    }
+	    which = NextClear(end);
+	}
+	if (bestLength == count)
+	    break;
+    }
+
+    if (length != NULL) {
+	*length = bestLength;
+	return bestStart;
+    }
+    return (bestLength == count) ? bestStart : -1;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindAndSetRange
+// 	Find a run of "count" clear bits, searching from bit "start" on,
+//	and set them.  Return the number of the first bit, or -1 if
+//	there is no run that long.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindAndSetRange(int count, int start)
+{
+    int first = FindRun(count, start);
+
+    if (first != -1)
+	MarkRange(first, count);
+    return first;
 }
 
 //----------------------------------------------------------------------
@@ -169,7 +345,7 @@ BitMap::SelfTest()
 {
     int i;
     
-    ASSERT(numBits >= BitsInWord);	// bitmap must be big enough
+    ASSERT(numBits >= 2 * BitsInWord);	// bitmap must be big enough
 
     ASSERT(NumClear() == numBits);	// bitmap must be empty
     ASSERT(FindAndSet() == 0);
@@ -185,7 +361,36 @@ BitMap::SelfTest()
         Mark(i);
     }
     ASSERT(FindAndSet() == -1);		// bitmap should be full!
+    ASSERT(NumClear() == 0);
     for (i = 0; i < numBits; i++) {
         Clear(i);
     }
+
+    i = FindAndSet();			// next fit: carry on from the
+    Clear(i);				// last bit handed out
+    ASSERT(FindAndSet() == (i + 1) % numBits);
+    Clear((i + 1) % numBits);
+
+    MarkRange(10, 5);			// runs
+    ASSERT(NumClear() == numBits - 5);
+    ASSERT(Test(10) && Test(14) && !Test(9) && !Test(15));
+    ASSERT(FindRun(10) == 0);
+    ASSERT(FindRun(11) == 15);
+    ASSERT(FindRun(5, 12) == 15);
+    ASSERT(FindRun(numBits) == -1);
+    ASSERT(FindAndSetRange(BitsInWord + 3, 1) == 15);
+    ASSERT(Test(15 + BitsInWord + 2) && !Test(15 + BitsInWord + 3));
+    ASSERT(FindRun(5, 20) == 15 + BitsInWord + 3);
+    ClearRange(10, BitsInWord + 8);
+    ASSERT(NumClear() == numBits);
+
+    MarkRange(0, numBits);		// longest run, when none is long
+    ClearRange(3, 3);			// enough
+    ClearRange(BitsInWord + 1, 2);
+    ASSERT(FindRun(4) == -1);
+    ASSERT(FindRun(4, 0, &i) == 3 && i == 3);
+    ASSERT(FindRun(4, BitsInWord, &i) == 3 && i == 3);
+    ASSERT(FindRun(2, 10, &i) == BitsInWord + 1 && i == 2);
+    ClearRange(0, numBits);
+    ASSERT(NumClear() == numBits);
 }
@@ -4,6 +4,8 @@
 //
 //	Represented as an array of unsigned integers, on which we do
 //	modulo arithmetic to find the bit we are interested in.
+//	Searches look at a whole word at a time, skipping words that
+//	are all set (or all clear) without testing their bits one by one.
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -44,6 +46,18 @@ class BitMap {
 				// If no bits are clear, return -1.
     int NumClear() const;	// Return the number of clear bits
 
+    void MarkRange(int first, int count);  // Set "count" bits from "first" on
+    void ClearRange(int first, int count); // Clear them
+    int FindRun(int count, int start = 0, int *length = NULL) const;
+				// Return the # of the first of "count"
+				// clear bits in a row, searching from
+				// "start" on.  If there is no such run,
+				// return -1 -- or, if "length" is given,
+				// the longest run there is.
+    int FindAndSetRange(int count, int start = 0);
+				// Find a run of "count" clear bits, and
+				// set them.  Return -1 if there is none.
+
     void Print() const;		// Print contents of bitmap
     void SelfTest();		// Test whether bitmap is working
     
@@ -54,6 +68,12 @@ class BitMap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+    int cursor;			// where the next FindAndSet starts
+				// looking ("next fit")
+
+  private:
+    int NextClear(int from) const;	// # of the first clear (set) bit
+    int NextSet(int from) const;	// at or after "from", or numBits
 };
 
 #endif // BITMAP_H
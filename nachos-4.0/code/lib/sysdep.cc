@@ -320,6 +320,58 @@ Lseek(int fd, int offset, int whence)
     ASSERT(retVal >= 0);
 }
 
+//----------------------------------------------------------------------
+// PRead
+// 	Read characters from an open file, starting at "offset", without
+//	a separate seek (and without moving the file position).  Abort
+//	if the read fails.
+//----------------------------------------------------------------------
+
+void
+PRead(int fd, char *buffer, int nBytes, int offset)
+{
+    int retVal = pread(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+//----------------------------------------------------------------------
+// PReadPartial
+// 	Read characters from an open file, starting at "offset",
+//	returning as many as are available.
+//----------------------------------------------------------------------
+
+int
+PReadPartial(int fd, char *buffer, int nBytes, int offset)
+{
+    return pread(fd, buffer, nBytes, offset);
+}
+
+//----------------------------------------------------------------------
+// PWrite
+// 	Write characters to an open file, starting at "offset", without
+//	a separate seek.  Abort if the write fails.
+//----------------------------------------------------------------------
+
+void
+PWrite(int fd, char *buffer, int nBytes, int offset)
+{
+    int retVal = pwrite(fd, buffer, nBytes, offset);
+    ASSERT(retVal == nBytes);
+}
+
+//----------------------------------------------------------------------
+// Fsync
+// 	Force what has been written to an open file out to the host's
+//	disk.  Abort on error.
+//----------------------------------------------------------------------
+
+void
+Fsync(int fd)
+{
+    int retVal = fsync(fd);
+    ASSERT(retVal >= 0);
+}
+
 //----------------------------------------------------------------------
 // Tell
 // 	Report the current location within an open file.
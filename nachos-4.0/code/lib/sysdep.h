@@ -39,7 +39,8 @@ extern void DeallocBoundedArray(char *p, int size);
 // If no characters in the file, return without waiting.
 extern bool PollFile(int fd);
 
-// File operations: open/read/write/lseek/close, and check for error
+// File operations: open/read/write/lseek/close, and check for error.
+// PRead/PWrite read/write at a given offset, in a single system call.
 // For simulating the disk and the console devices.
 extern int OpenForWrite(char *name);
 extern int OpenForReadWrite(char *name, bool crashOnError);
@@ -47,6 +48,10 @@ extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
+extern void PRead(int fd, char *buffer, int nBytes, int offset);
+extern int PReadPartial(int fd, char *buffer, int nBytes, int offset);
+extern void PWrite(int fd, char *buffer, int nBytes, int offset);
+extern void Fsync(int fd);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(char *name);
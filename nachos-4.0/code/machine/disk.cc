@@ -26,6 +26,8 @@ const int MagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
 const int DiskSize = (MagicSize + (NumSectors * SectorSize));
 
+DiskSyncPolicy Disk::syncPolicy = SyncNever;
+
 
 //----------------------------------------------------------------------
 // Disk::Disk()
@@ -71,6 +73,8 @@ Disk::Disk(char* name, CallBackObj *toCall)
 
 Disk::~Disk()
 {
+    if (syncPolicy == SyncOnClose)
+	Fsync(fileno);
     Close(fileno);
 }
 
@@ -96,55 +100,63 @@ PrintSector (bool writing, int sector, char *data)
 
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
-// 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+// 	Simulate a request to read/write a run of disk sectors
+//	   Do the read/write immediately to the UNIX file, with a single
+//	      positional I/O call
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
 //
 //	Note that a disk only allows an entire sector to be read/written,
-//	not part of a sector.
+//	not part of a sector.  The run must not cross a track boundary.
 //
-//	"sectorNumber" -- the disk sector to read/write
+//	"sectorNumber" -- the first disk sector to read/write
 //	"data" -- the bytes to be written, the buffer to hold the incoming bytes
+//	"count" -- the number of consecutive sectors
 //----------------------------------------------------------------------
 
 void
-Disk::ReadRequest(int sectorNumber, char* data)
+Disk::ReadRequest(int sectorNumber, char* data, int count)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    int ticks = ComputeLatency(sectorNumber, FALSE, count);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0) && 
+	(sectorNumber % SectorsPerTrack + count <= SectorsPerTrack) &&
+	(sectorNumber + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Reading " << count << " sectors from sector " << sectorNumber);
+    PRead(fileno, data, SectorSize * count, SectorSize * sectorNumber + MagicSize);
     if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+	for (int i = 0; i < count; i++)
+	    PrintSector(FALSE, sectorNumber + i, data + i * SectorSize);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, count);
     kernel->stats->numDiskReads++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, char* data, int count)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, TRUE, count);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (count > 0) && 
+	(sectorNumber % SectorsPerTrack + count <= SectorsPerTrack) &&
+	(sectorNumber + count <= NumSectors));
     
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG(dbgDisk, "Writing " << count << " sectors to sector " << sectorNumber);
+    PWrite(fileno, data, SectorSize * count, SectorSize * sectorNumber + MagicSize);
+    if (syncPolicy == SyncAlways)
+	Fsync(fileno);
     if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+	for (int i = 0; i < count; i++)
+	    PrintSector(TRUE, sectorNumber + i, data + i * SectorSize);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, count);
     kernel->stats->numDiskWrites++;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
@@ -206,10 +218,11 @@ Disk::ModuloDiff(int to, int from)
 
 //----------------------------------------------------------------------
 // Disk::ComputeLatency()
-// 	Return how long will it take to read/write a disk sector, from
-//	the current position of the disk head.
+// 	Return how long will it take to read/write a run of "count"
+//	disk sectors, from the current position of the disk head.
 //
-//   	Latency = seek time + rotational latency + transfer time
+//   	Latency = seek time + rotational latency + transfer time, where
+//	the transfer time is one rotation time per sector of the run
 //   	Disk seeks at one track per SeekTime ticks (cf. stats.h)
 //   	and rotates at one sector per RotationTime ticks
 //
@@ -226,42 +239,44 @@ Disk::ModuloDiff(int to, int from)
 //----------------------------------------------------------------------
 
 int
-Disk::ComputeLatency(int newSector, bool writing)
+Disk::ComputeLatency(int newSector, bool writing, int count)
 {
     int rotation;
     int seek = TimeToSeek(newSector, &rotation);
     int timeAfter = kernel->stats->totalTicks + seek + rotation;
+    int lastOfRun = newSector + count - 1;
 
 #ifndef NOTRACKBUF	// turn this on if you don't want the track buffer stuff
-    // check if track buffer applies
+    // check if track buffer applies (to every sector of the run)
     if ((writing == FALSE) && (seek == 0) 
 		&& (((timeAfter - bufferInit) / RotationTime) 
-	     		> ModuloDiff(newSector, bufferInit / RotationTime))) {
-        DEBUG(dbgDisk, "Request latency = " << RotationTime);
-	return RotationTime; // time to transfer sector from the track buffer
+	     		> ModuloDiff(lastOfRun, bufferInit / RotationTime))) {
+        DEBUG(dbgDisk, "Request latency = " << count * RotationTime);
+	return count * RotationTime; // transfer sectors from the track buffer
     }
 #endif
 
     rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
 
-    DEBUG(dbgDisk, "Request latency = " << (seek + rotation + RotationTime));
-    return(seek + rotation + RotationTime);
+    DEBUG(dbgDisk, "Request latency = " << (seek + rotation + count * RotationTime));
+    return(seek + rotation + count * RotationTime);
 }
 
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer.  After a run of sectors, the head is
+//	at the last sector of the run.
 //----------------------------------------------------------------------
 
 void
-Disk::UpdateLast(int newSector)
+Disk::UpdateLast(int newSector, int count)
 {
     int rotate;
     int seek = TimeToSeek(newSector, &rotate);
     
     if (seek != 0)
 	bufferInit = kernel->stats->totalTicks + seek + rotate;
-    lastSector = newSector;
+    lastSector = newSector + count - 1;
     DEBUG(dbgDisk, "Updating last sector = " << lastSector << " , " << bufferInit);
 }
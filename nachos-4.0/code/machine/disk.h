@@ -46,6 +46,10 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// A request may transfer a run of consecutive sectors, up to a whole
+// track, with a single interrupt at the end: the head seeks and waits
+// for the first sector once, then the rest stream past under it.
 
 const int SectorSize = 128;		// number of bytes per disk sector
 const int SectorsPerTrack  = 32;	// number of sectors per disk track 
@@ -53,6 +57,16 @@ const int NumTracks = 32;		// number of tracks per disk
 const int NumSectors = (SectorsPerTrack * NumTracks);
 					// total # of sectors per disk
 
+// When to force writes to the UNIX file simulating the disk out to
+// the host's own disk.  Without this, a host crash can lose writes the
+// Nachos kernel believes are done.
+
+enum DiskSyncPolicy {
+    SyncNever,		// leave it to the host (fastest)
+    SyncOnClose,	// once, when the disk is shut down
+    SyncAlways		// after every write request (safest)
+};
+
 class Disk : public CallBackObj {
   public:
     Disk(char* name, CallBackObj *toCall); // Create a simulated disk.  
@@ -60,18 +74,23 @@ class Disk : public CallBackObj {
 					// when each request completes.
     ~Disk();				// Deallocate the disk.
     
-    void ReadRequest(int sectorNumber, char* data);
-    					// Read/write an single disk sector.
+    void ReadRequest(int sectorNumber, char* data, int count = 1);
+    					// Read/write "count" consecutive disk
+					// sectors, all on the same track, 
+					// to/from "data".
 					// These routines send a request to 
     					// the disk and return immediately.
     					// Only one request allowed at a time!
-    void WriteRequest(int sectorNumber, char* data);
+    void WriteRequest(int sectorNumber, char* data, int count = 1);
 
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
-    int ComputeLatency(int newSector, bool writing);	
-    					// Return how long a request to 
+    static DiskSyncPolicy syncPolicy;	// when to fsync the UNIX file
+
+    int ComputeLatency(int newSector, bool writing, int count = 1);	
+    					// Return how long a request for 
+					// "count" sectors starting at
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
 
@@ -85,7 +104,7 @@ class Disk : public CallBackObj {
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
-    void UpdateLast(int newSector);
+    void UpdateLast(int newSector, int count);
 };
 
 #endif // DISK_H
@@ -70,6 +70,9 @@ Machine::Machine(bool debug)
     tlb = NULL;
     pageTable = NULL;
 #endif
+    pageDirectory = NULL;
+    lastLeaf = NULL;
+    lastLeafIndex = 0;
 
     singleStep = debug;
     CheckEndian();
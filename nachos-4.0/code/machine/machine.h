@@ -34,6 +34,17 @@ const unsigned int NumPhysPages = 32;
 const int MemorySize = (NumPhysPages * PageSize);
 const int TLBSize = 4;			// if there is a TLB, make it small
 
+// Two-level page tables: the upper bits of a virtual page number index
+// a page directory, the lower PageLeafBits bits index a leaf page table.
+// Leaf tables are only allocated for parts of the address space that
+// are actually used, so a sparse address space stays cheap.
+
+const unsigned int PageLeafBits = 6;
+const unsigned int PageLeafSize = (1 << PageLeafBits);	// entries per leaf
+const unsigned int PageDirSize = 1024;	// leaf tables per directory
+const unsigned int MaxVirtPages = (PageDirSize * PageLeafSize);
+					// largest address space, in pages
+
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
 		     PageFaultException,    // No valid translation found
@@ -115,7 +126,9 @@ class Machine {
 //  	a software-loaded translation lookaside buffer (tlb) -- a cache of 
 //	  mappings of virtual page #'s to physical page #'s
 //
-// If "tlb" is NULL, the linear page table is used
+// If "tlb" is NULL, the linear page table is used, or if "pageDirectory"
+//	is non-NULL, the two-level page table.  Either way, "pageTableSize"
+//	is the number of virtual pages in the address space.
 // If "tlb" is non-NULL, the Nachos kernel is responsible for managing
 //	the contents of the TLB.  But the kernel can use any data structure
 //	it wants (eg, segmented paging) for handling TLB cache misses.
@@ -131,6 +144,14 @@ class Machine {
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
+
+    TranslationEntry **pageDirectory;	// two-level page table: array of
+					// PageDirSize leaf tables, NULL
+					// for unused parts of the space
+    unsigned int lastLeafIndex;		// directory index of "lastLeaf"
+    TranslationEntry *lastLeaf;		// most recently used leaf table,
+					// so that a walk usually costs 
+					// no more than a linear lookup
     bool ReadMem(int addr, int size, int* value);
   private:
 
@@ -22,6 +22,19 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numCacheHits = numCacheMisses = numCacheWriteBacks = 0;
+    numCachePrefetches = 0;
+    numDirCacheHits = numDirCacheMisses = 0;
+    numJournalCommits = numJournalBlocks = numJournalReplays = 0;
+    numLogSegments = numLogCheckpoints = numLogCleaned = 0;
+    numLogRollForwards = 0;
+
+    paging = new PagingStats("total");
+    procPaging = new List<PagingStats *>;
+    pagingDumpFile = NULL;
+    numOccupancySamples = occupancySum = occupancyMax = occupancyCount = 0;
+    occupancyStride = 1;
+    occupancySkip = 0;
 }
 
 //----------------------------------------------------------------------
@@ -37,9 +50,268 @@ Statistics::Print()
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
 		cout << ", writes " << numDiskWrites << "\n";
+    if (numCacheHits + numCacheMisses > 0) {
+	cout << "Buffer cache: hits " << numCacheHits << ", misses ";
+	cout << numCacheMisses << ", write-backs " << numCacheWriteBacks;
+	cout << ", prefetches " << numCachePrefetches << "\n";
+    }
+    if (numDirCacheHits + numDirCacheMisses > 0) {
+	cout << "Lookup cache: hits " << numDirCacheHits;
+	cout << ", misses " << numDirCacheMisses << "\n";
+    }
+    if (numJournalCommits + numJournalReplays > 0) {
+	cout << "Journal: commits " << numJournalCommits << ", sectors ";
+	cout << numJournalBlocks << ", replays " << numJournalReplays << "\n";
+    }
+    if (numLogSegments + numLogRollForwards > 0) {
+	cout << "Log: segments " << numLogSegments << ", checkpoints ";
+	cout << numLogCheckpoints << ", cleaned " << numLogCleaned;
+	cout << ", rolled forward " << numLogRollForwards << "\n";
+    }
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
+    if (numPageFaults > 0) {
+	paging->Print();
+	if (occupancyCount > 0) {
+	    cout << "Paging: frame occupancy avg " 
+		<< (occupancySum / occupancyCount) << ", max " << occupancyMax;
+	    cout << " (" << occupancyCount << " samples)\n";
+	}
+	ListIterator<PagingStats *> iter(procPaging);
+	for (; !iter.IsDone(); iter.Next()) {
+	    if (iter.Item()->numFaults > 0)
+		iter.Item()->Print();
+	}
+    }
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    if (pagingDumpFile != NULL)
+	DumpPaging(pagingDumpFile);
+}
+
+//----------------------------------------------------------------------
+// Statistics::NewProcessPaging
+// 	Return a fresh set of paging counters for a process that is
+//	about to start.  The counters are owned by the statistics module
+//	rather than the address space, so that they can still be printed
+//	at shutdown after the process has exited.
+//
+//	"name" -- the name of the process, for printing
+//----------------------------------------------------------------------
+
+PagingStats *
+Statistics::NewProcessPaging(char *name)
+{
+    PagingStats *ps = new PagingStats(name);
+
+    procPaging->Append(ps);
+    return ps;
+}
+
+//----------------------------------------------------------------------
+// Statistics::SampleOccupancy
+// 	Record how many physical page frames are in use at the current
+//	time.  We keep the average and maximum over every sample, but only
+//	a decimated series of (time, frames) pairs, so that memory use
+//	stays bounded no matter how long the run is.
+//
+//	"usedFrames" -- number of physical frames currently allocated
+//----------------------------------------------------------------------
+
+void
+Statistics::SampleOccupancy(int usedFrames)
+{
+    occupancySum += usedFrames;
+    occupancyCount++;
+    if (usedFrames > occupancyMax)
+	occupancyMax = usedFrames;
+
+    if (occupancySkip > 0) {
+	occupancySkip--;
+	return;
+    }
+    if (numOccupancySamples == MaxOccupancySamples) {
+	// buffer is full: keep every other sample, and sample half as often
+	for (int i = 0; i < MaxOccupancySamples / 2; i++) {
+	    occupancyTick[i] = occupancyTick[2 * i];
+	    occupancyFrames[i] = occupancyFrames[2 * i];
+	}
+	numOccupancySamples = MaxOccupancySamples / 2;
+	occupancyStride *= 2;
+    }
+    occupancyTick[numOccupancySamples] = totalTicks;
+    occupancyFrames[numOccupancySamples] = usedFrames;
+    numOccupancySamples++;
+    occupancySkip = occupancyStride - 1;
+}
+
+//----------------------------------------------------------------------
+// Statistics::DumpPaging
+// 	Write the global and per-process paging statistics, and the
+//	frame occupancy series, to a file, so that runs with different
+//	replacement policies can be compared with external tools.
+//
+//	If "fileName" ends in ".csv", we write comma separated values:
+//	one row per process (plus a "total" row), then a blank line,
+//	then the occupancy series.  Otherwise, we write a JSON object.
+//
+//	"fileName" -- UNIX file to write the statistics into
+//----------------------------------------------------------------------
+
+void
+Statistics::DumpPaging(char *fileName)
+{
+    int len = strlen(fileName);
+    bool csv = (len > 4) && (strcmp(fileName + len - 4, ".csv") == 0);
+    FILE *fp = fopen(fileName, "w");
+    ListIterator<PagingStats *> iter(procPaging);
+    int i;
+
+    if (fp == NULL) {
+	cerr << "Unable to write paging statistics to " << fileName << "\n";
+	return;
+    }
+    if (csv) {
+	fprintf(fp, "process,faults,major,minor,swapins,swapouts,"
+		"clean_evictions,dirty_evictions,victim_selections,"
+		"victim_scans,fault_ticks,max_fault_ticks");
+	for (i = 0; i < NumFaultHistBuckets; i++)
+	    fprintf(fp, ",hist%d", i);
+	fprintf(fp, "\n");
+	paging->PrintCSV(fp);
+	for (; !iter.IsDone(); iter.Next())
+	    iter.Item()->PrintCSV(fp);
+	fprintf(fp, "\ntick,frames\n");
+	for (i = 0; i < numOccupancySamples; i++)
+	    fprintf(fp, "%d,%d\n", occupancyTick[i], occupancyFrames[i]);
+    } else {
+	fprintf(fp, "{\n\"histogramBase\": %d,\n\"total\": ", FaultHistBase);
+	paging->PrintJSON(fp);
+	fprintf(fp, ",\n\"processes\": [");
+	for (i = 0; !iter.IsDone(); iter.Next(), i++) {
+	    fprintf(fp, "%s\n  ", (i > 0) ? "," : "");
+	    iter.Item()->PrintJSON(fp);
+	}
+	fprintf(fp, "],\n\"occupancy\": [");
+	for (i = 0; i < numOccupancySamples; i++)
+	    fprintf(fp, "%s[%d, %d]", (i > 0) ? ", " : "",
+			occupancyTick[i], occupancyFrames[i]);
+	fprintf(fp, "]\n}\n");
+    }
+    fclose(fp);
+}
+
+//----------------------------------------------------------------------
+// PagingStats::PagingStats
+// 	Initialize the paging counters of one process to zero.
+//
+//	"debugName" -- the name of the process
+//----------------------------------------------------------------------
+
+PagingStats::PagingStats(char *debugName)
+{
+    name = debugName;
+    numFaults = numMajorFaults = numMinorFaults = 0;
+    numSwapIns = numSwapOuts = 0;
+    numCleanEvictions = numDirtyEvictions = 0;
+    numVictimSelections = numVictimScans = 0;
+    faultTicks = maxFaultTicks = 0;
+    for (int i = 0; i < NumFaultHistBuckets; i++)
+	faultHist[i] = 0;
+}
+
+//----------------------------------------------------------------------
+// PagingStats::RecordFault
+// 	Account for one page fault, once it has been serviced.
+//
+//	"ticks" -- how long it took to service the fault
+//	"major" -- TRUE if the fault had to wait for the disk
+//----------------------------------------------------------------------
+
+void
+PagingStats::RecordFault(int ticks, bool major)
+{
+    int bucket = 0;
+
+    numFaults++;
+    if (major)
+	numMajorFaults++;
+    else
+	numMinorFaults++;
+    faultTicks += ticks;
+    if (ticks > maxFaultTicks)
+	maxFaultTicks = ticks;
+    while ((bucket < NumFaultHistBuckets - 1) 
+		&& (ticks >= (FaultHistBase << bucket)))
+	bucket++;
+    faultHist[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// PagingStats::Print
+// 	Print the paging counters, as part of the statistics printed
+//	at system shutdown.
+//----------------------------------------------------------------------
+
+void
+PagingStats::Print()
+{
+    cout << "Paging [" << name << "]: faults " << numFaults;
+    cout << " (major " << numMajorFaults << ", minor " << numMinorFaults;
+    cout << "), swap in " << numSwapIns << ", out " << numSwapOuts << "\n";
+    cout << "Paging [" << name << "]: evictions clean " << numCleanEvictions;
+    cout << ", dirty " << numDirtyEvictions << ", victim scans ";
+    cout << numVictimScans << " in " << numVictimSelections << " selections\n";
+    cout << "Paging [" << name << "]: fault ticks total " << faultTicks;
+    if (numFaults > 0)
+	cout << ", avg " << (faultTicks / numFaults);
+    cout << ", max " << maxFaultTicks << "\n";
+    cout << "Paging [" << name << "]: fault ticks histogram";
+    for (int i = 0; i < NumFaultHistBuckets; i++) {
+	if (i < NumFaultHistBuckets - 1)
+	    cout << " <" << (FaultHistBase << i) << ":" << faultHist[i];
+	else
+	    cout << " more:" << faultHist[i];
+    }
+    cout << "\n";
+}
+
+//----------------------------------------------------------------------
+// PagingStats::PrintCSV
+// 	Print the paging counters as one comma separated row, in the
+//	column order written by Statistics::DumpPaging.
+//----------------------------------------------------------------------
+
+void
+PagingStats::PrintCSV(FILE *fp)
+{
+    fprintf(fp, "%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d", name, numFaults,
+	    numMajorFaults, numMinorFaults, numSwapIns, numSwapOuts,
+	    numCleanEvictions, numDirtyEvictions, numVictimSelections,
+	    numVictimScans, faultTicks, maxFaultTicks);
+    for (int i = 0; i < NumFaultHistBuckets; i++)
+	fprintf(fp, ",%d", faultHist[i]);
+    fprintf(fp, "\n");
+}
+
+//----------------------------------------------------------------------
+// PagingStats::PrintJSON
+// 	Print the paging counters as a single JSON object.
+//----------------------------------------------------------------------
+
+void
+PagingStats::PrintJSON(FILE *fp)
+{
+    fprintf(fp, "{\"name\": \"%s\", \"faults\": %d, \"major\": %d, "
+	    "\"minor\": %d, \"swapIns\": %d, \"swapOuts\": %d, "
+	    "\"cleanEvictions\": %d, \"dirtyEvictions\": %d, "
+	    "\"victimSelections\": %d, \"victimScans\": %d, "
+	    "\"faultTicks\": %d, \"maxFaultTicks\": %d, \"histogram\": [",
+	    name, numFaults, numMajorFaults, numMinorFaults, numSwapIns,
+	    numSwapOuts, numCleanEvictions, numDirtyEvictions,
+	    numVictimSelections, numVictimScans, faultTicks, maxFaultTicks);
+    for (int i = 0; i < NumFaultHistBuckets; i++)
+	fprintf(fp, "%s%d", (i > 0) ? ", " : "", faultHist[i]);
+    fprintf(fp, "]}");
 }
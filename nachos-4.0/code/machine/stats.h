@@ -12,6 +12,53 @@
 #define STATS_H
 
 #include "copyright.h"
+#include "list.h"
+#include <stdio.h>
+
+// Page fault service times are kept in a histogram with power-of-two
+// buckets: bucket 0 counts faults serviced in fewer than FaultHistBase
+// ticks, bucket i counts those under (FaultHistBase << i) ticks, and
+// the last bucket counts everything slower than that.
+
+const int NumFaultHistBuckets = 12;
+const int FaultHistBase = 16;
+
+// Frame occupancy is sampled on every page fault.  When the sample
+// buffer fills up we drop every other sample and halve the sampling
+// rate, so a long run still produces a bounded, evenly spread series.
+
+const int MaxOccupancySamples = 256;
+
+// The following class defines the paging counters kept for a single
+// process (address space), and -- summed over all processes -- for the
+// system as a whole.  A "major" fault needs a disk read to bring the
+// page in; a "minor" fault is serviced from memory alone.
+
+class PagingStats {
+  public:
+    PagingStats(char *debugName);	// initialize everything to zero
+
+    char *name;			// process (executable) name
+    int numFaults;		// page faults taken
+    int numMajorFaults;		// faults that had to read the disk
+    int numMinorFaults;		// faults serviced without disk I/O
+    int numSwapIns;		// pages read in from the swap space
+    int numSwapOuts;		// pages written out to the swap space
+    int numCleanEvictions;	// evicted pages that were not modified
+    int numDirtyEvictions;	// evicted pages that were modified
+    int numVictimSelections;	// times a replacement victim was chosen
+    int numVictimScans;		// frame table entries examined doing so
+    int faultTicks;		// total ticks spent servicing faults
+    int maxFaultTicks;		// slowest single fault
+    int faultHist[NumFaultHistBuckets];
+				// histogram of fault service times
+
+    void RecordFault(int ticks, bool major);
+				// account for one serviced fault
+    void Print();		// print the counters, human readable
+    void PrintCSV(FILE *fp);	// print as one CSV row
+    void PrintJSON(FILE *fp);	// print as one JSON object
+};
 
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
@@ -35,10 +82,48 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numCacheHits;		// buffer cache requests found in the cache
+    int numCacheMisses;		// requests for sectors not in the cache
+    int numCacheWriteBacks;	// dirty sectors written back by the cache
+    int numCachePrefetches;	// sectors read in ahead of time
+    int numDirCacheHits;	// path components found in the lookup cache
+    int numDirCacheMisses;	// ones that had to be read from a directory
+    int numJournalCommits;	// groups of transactions committed
+    int numJournalBlocks;	// sectors written through the journal
+    int numJournalReplays;	// groups replayed when the disk was mounted
+    int numLogSegments;		// segments written to a log-structured disk
+    int numLogCheckpoints;	// checkpoints of its sector map
+    int numLogCleaned;		// segments the cleaner emptied
+    int numLogRollForwards;	// segments rolled forward when mounting
+
+    PagingStats *paging;	// paging counters, summed over all processes
+    List<PagingStats *> *procPaging;
+				// paging counters of each process
+    char *pagingDumpFile;	// if non-NULL, where to dump the paging
+				// statistics at shutdown (CSV if the name
+				// ends in ".csv", JSON otherwise)
 
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
+
+    PagingStats *NewProcessPaging(char *name);
+				// paging counters for a new process;
+				// kept until shutdown so they can be printed
+    void SampleOccupancy(int usedFrames);
+				// record physical frame occupancy "now"
+    void DumpPaging(char *fileName);
+				// write paging statistics to a file
+
+  private:
+    int occupancyTick[MaxOccupancySamples];	// when each sample was taken
+    int occupancyFrames[MaxOccupancySamples];	// frames in use at the time
+    int numOccupancySamples;	// number of samples in the buffer
+    int occupancyStride;	// keep one sample out of this many
+    int occupancySkip;		// samples to skip before keeping the next
+    int occupancySum;		// sum and maximum of all samples taken
+    int occupancyMax;
+    int occupancyCount;
 };
 
 // Constants used to reflect the relative time an operation would
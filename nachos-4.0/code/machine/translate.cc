@@ -4,11 +4,16 @@
 //	in the table on every memory reference to find the true physical
 //	memory location.
 //
-// Two types of translation are supported here.
+// Three types of translation are supported here.
 //
 //	Linear page table -- the virtual page # is used as an index
 //	into the table, to find the physical page #.
 //
+//	Two-level page table -- the high bits of the virtual page #
+//	select a leaf table from a page directory, the low bits index
+//	into the leaf table.  The most recently used leaf is cached,
+//	so consecutive references to the same region skip the directory.
+//
 //	Translation lookaside buffer -- associative lookup in the table
 //	to find an entry with the same virtual page #.  If found,
 //	this entry is used for the translation.
@@ -185,7 +190,7 @@ ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
     int i;
-    unsigned int vpn, offset;
+    unsigned int vpn, offset, dirIndex;
     TranslationEntry *entry;
     unsigned int pageFrame;
 
@@ -198,15 +203,34 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     }
     
     // we must have either a TLB or a page table, but not both!
-    ASSERT(tlb == NULL || pageTable == NULL);	
-    ASSERT(tlb != NULL || pageTable != NULL);	
+    ASSERT(tlb == NULL || (pageTable == NULL && pageDirectory == NULL));
+    ASSERT(tlb != NULL || pageTable != NULL || pageDirectory != NULL);	
 
 // calculate the virtual page number, and offset within the page,
 // from the virtual address
     vpn = (unsigned) virtAddr / PageSize;
     offset = (unsigned) virtAddr % PageSize;
     
-    if (tlb == NULL) {		// => page table => vpn is index into table
+    if (tlb == NULL && pageDirectory != NULL) {	// => two-level page table
+	if (vpn >= pageTableSize) {
+	    DEBUG(dbgAddr, "Illegal virtual page # " << virtAddr);
+	    return AddressErrorException;
+	}
+	dirIndex = vpn >> PageLeafBits;
+	if (lastLeaf == NULL || lastLeafIndex != dirIndex) {
+	    if (pageDirectory[dirIndex] == NULL) {
+		DEBUG(dbgAddr, "No leaf page table for virtual page # " << virtAddr);
+		return PageFaultException;
+	    }
+	    lastLeaf = pageDirectory[dirIndex];
+	    lastLeafIndex = dirIndex;
+	}
+	entry = &lastLeaf[vpn & (PageLeafSize - 1)];
+	if (!entry->valid) {
+	    DEBUG(dbgAddr, "Invalid virtual page # " << virtAddr);
+	    return PageFaultException;
+	}
+    } else if (tlb == NULL) {	// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
 	    DEBUG(dbgAddr, "Illegal virtual page # " << virtAddr);
 	    return AddressErrorException;
@@ -0,0 +1,55 @@
+/* fileio.c
+ *	Simple program to test the file system calls: Create, Open,
+ *	Read, Write and Close.
+ *
+ *	Writes a buffer spanning several pages to a new file, reads it
+ *	back, checks it, and says so on the console.
+ */
+
+#include "syscall.h"
+
+#define Size	3000			/* more than a few pages */
+
+char out[Size], in[Size];
+
+void
+Say(char *s)
+{
+    int n;
+
+    for (n = 0; s[n] != '\0'; n++)
+	;
+    Write(s, n, ConsoleOutput);
+}
+
+int
+main()
+{
+    OpenFileId f;
+    int i;
+
+    for (i = 0; i < Size; i++)
+	out[i] = 'a' + i % 26;
+    Create("fileio.out");
+    f = Open("fileio.out");
+    if (f < 0) {
+	Say("fileio: can't open fileio.out\n");
+	Halt();
+    }
+    Write(out, Size, f);
+    Close(f);
+
+    f = Open("fileio.out");
+    PrintInt(Read(in, Size, f));		/* Size */
+    PrintInt(Read(in, Size, f));		/* 0: end of file */
+    Close(f);
+    PrintInt(Read(in, Size, f));		/* -1: closed */
+
+    for (i = 0; i < Size; i++)
+	if (in[i] != out[i]) {
+	    Say("fileio: read back the wrong data\n");
+	    Halt();
+	}
+    Say("fileio: ok\n");
+    Halt();
+}
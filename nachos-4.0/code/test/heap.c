@@ -0,0 +1,58 @@
+/* heap.c
+ *	Simple program to test the Sbrk system call and the user-level
+ *	allocator built on it.
+ *
+ *	Allocates a linked list bigger than physical memory, so heap
+ *	pages get zero-filled on first touch and then paged out and back
+ *	in, sums it, frees it, and allocates it again to check that freed
+ *	memory is reused rather than taken from Sbrk.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+#define N	1000		/* number of list cells: with malloc's header,
+				 * about 560 pages, well over the 32 frames
+				 * but inside the 1024 swap sectors */
+
+typedef struct cell {
+    struct cell *next;
+    int value;
+    int pad[14];		/* make each cell 64 bytes */
+} Cell;
+
+int
+main()
+{
+    Cell *head, *c, *next;
+    int i, sum;
+    int top;
+
+    head = 0;
+    for (i = 0; i < N; i++) {
+	c = (Cell *) malloc(sizeof(Cell));
+	if (c == 0)
+	    break;
+	c->value = i;
+	c->next = head;
+	head = c;
+    }
+    PrintInt(i);			/* cells allocated */
+
+    sum = 0;
+    for (c = head; c != 0; c = c->next)
+	sum += c->value;
+    PrintInt(sum);			/* N*(N-1)/2 */
+
+    for (c = head; c != 0; c = next) {
+	next = c->next;
+	free((void *) c);
+    }
+    top = Sbrk(0);
+    for (i = 0; i < N; i++)
+	if (malloc(sizeof(Cell)) == 0)
+	    break;
+    PrintInt(Sbrk(0) == top);		/* 1: heap did not grow */
+
+    Halt();
+}
@@ -0,0 +1,110 @@
+/* malloc.c 
+ *	A simple first-fit storage allocator for user programs.
+ *
+ *	Free chunks are kept on a list sorted by address, so that a
+ *	chunk being freed can be merged with its neighbours.  When no
+ *	free chunk is big enough, we ask the kernel for more heap with
+ *	Sbrk, in units of at least HEAP_GROW bytes.  Memory obtained
+ *	from Sbrk is never given back.
+ *
+ *	Every chunk starts with a header holding its size (including
+ *	the header) in units of the header, which also keeps every
+ *	block aligned for any type.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+#define HEAP_GROW	1024	/* minimum bytes to ask Sbrk for */
+
+typedef union header {
+    struct {
+	union header *next;	/* next free chunk, by address */
+	int units;		/* size of this chunk, in headers */
+    } s;
+    double align;		/* force alignment of blocks */
+} Header;
+
+static Header *freeList = 0;	/* free chunks, sorted by address */
+
+/* Put "chunk" on the free list, merging with adjacent free chunks. */
+void
+free(void *ptr)
+{
+    Header *chunk, *prev, *p;
+
+    if (ptr == 0)
+	return;
+    chunk = (Header *) ptr - 1;
+
+    prev = 0;
+    for (p = freeList; p != 0 && p < chunk; p = p->s.next)
+	prev = p;
+
+    /* merge with the next chunk */
+    if (p != 0 && chunk + chunk->s.units == p) {
+	chunk->s.units += p->s.units;
+	chunk->s.next = p->s.next;
+    } else
+	chunk->s.next = p;
+
+    /* merge with the previous chunk */
+    if (prev != 0 && prev + prev->s.units == chunk) {
+	prev->s.units += chunk->s.units;
+	prev->s.next = chunk->s.next;
+    } else if (prev != 0)
+	prev->s.next = chunk;
+    else
+	freeList = chunk;
+}
+
+/* Grow the heap by at least "units" headers; return 0 on failure. */
+static int
+moreCore(int units)
+{
+    int bytes;
+    Header *chunk;
+
+    bytes = units * sizeof(Header);
+    if (bytes < HEAP_GROW)
+	bytes = HEAP_GROW;
+    chunk = (Header *) Sbrk(bytes);
+    if ((int) chunk == -1)
+	return 0;
+    chunk->s.units = bytes / sizeof(Header);
+    free((void *) (chunk + 1));
+    return 1;
+}
+
+void *
+malloc(int size)
+{
+    Header *p, *prev;
+    int units;
+
+    if (size <= 0)
+	return 0;
+    units = (size + sizeof(Header) - 1) / sizeof(Header) + 1;
+
+    for (;;) {
+	prev = 0;
+	for (p = freeList; p != 0; p = p->s.next) {
+	    if (p->s.units >= units) {
+		if (p->s.units == units) {	/* exact fit: unlink it */
+		    if (prev != 0)
+			prev->s.next = p->s.next;
+		    else
+			freeList = p->s.next;
+		} else {			/* hand out the tail end */
+		    p->s.units -= units;
+		    p += p->s.units;
+		    p->s.units = units;
+		}
+		return (void *) (p + 1);
+	    }
+	    prev = p;
+	}
+	if (!moreCore(units))
+	    return 0;
+    }
+}
@@ -0,0 +1,14 @@
+/* malloc.h 
+ *	Interface to a simple user-level storage allocator, built on
+ *	top of the Sbrk system call.
+ *
+ *	Link malloc.o into any user program that includes this file.
+ */
+
+#ifndef MALLOC_H
+#define MALLOC_H
+
+void *malloc(int size);		/* return "size" bytes, or 0 */
+void free(void *ptr);		/* give back memory from malloc */
+
+#endif /* MALLOC_H */
@@ -0,0 +1,30 @@
+/* mmap.c
+ *	Simple program to test the Mmap and Munmap system calls.
+ *
+ *	Maps the file "mmap.c" (this source file), counts the lines in
+ *	it straight out of the mapping, and unmaps it again.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    char *p;
+    int i, end, lines;
+
+    p = (char *) Mmap("mmap.c", 0);
+    if ((int) p == -1)
+	Exit(1);
+
+    end = Sbrk(0) - (int) p;		/* the mapping is zero-padded */
+    lines = 0;				/* up to a page boundary */
+    for (i = 0; i < end; i++)
+	if (p[i] == '\n')
+	    lines++;
+    PrintInt(lines);
+
+    PrintInt(Munmap((int) p));		/* 0 */
+    PrintInt(Munmap((int) p));		/* -1: already unmapped */
+    Halt();
+}
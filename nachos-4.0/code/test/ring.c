@@ -0,0 +1,79 @@
+/* ring.c
+ *	Simple program to test the asynchronous request ring: RingSetup
+ *	and RingEnter.
+ *
+ *	Writes the blocks of a file with one RingEnter, all of them in 
+ *	flight at once, along with a sleep; then reads them back the 
+ *	same way, and checks them.
+ */
+
+#include "syscall.h"
+
+#define NumBlocks	8
+#define BlockSize	256
+
+Ring ring;
+char out[NumBlocks][BlockSize], in[NumBlocks][BlockSize];
+
+void
+Queue(int op, OpenFileId f, char *buffer, int size, int offset, int tag)
+{
+    RingRequest *r = &ring.sq[ring.sqTail % RingSize];
+
+    r->op = op;
+    r->id = f;
+    r->buffer = buffer;
+    r->size = size;
+    r->offset = offset;
+    r->userData = tag;
+    ring.sqTail++;
+}
+
+/* Consume every completion posted; return how many failed. */
+int
+Reap()
+{
+    int failed = 0;
+
+    while (ring.cqHead != ring.cqTail) {
+	if (ring.cq[ring.cqHead % RingSize].result < 0)
+	    failed++;
+	ring.cqHead++;
+    }
+    return failed;
+}
+
+int
+main()
+{
+    OpenFileId f;
+    int i, j;
+
+    if (RingSetup(&ring) < 0)
+	Exit(1);
+    for (i = 0; i < NumBlocks; i++)
+	for (j = 0; j < BlockSize; j++)
+	    out[i][j] = 'a' + (i + j) % 26;
+    Create("ring.out");
+    f = Open("ring.out");
+    Write(out[0], NumBlocks * BlockSize, f);	/* give it its length */
+
+    for (i = NumBlocks - 1; i >= 0; i--)	/* in any order */
+	Queue(RingWrite, f, out[i], BlockSize, i * BlockSize, i);
+    Queue(RingSleep, 0, 0, 10, 0, -1);
+    PrintInt(RingEnter(NumBlocks + 1, NumBlocks + 1));	/* NumBlocks + 1 */
+    PrintInt(Reap());					/* 0 */
+
+    for (i = 0; i < NumBlocks; i++)
+	Queue(RingRead, f, in[i], BlockSize, i * BlockSize, i);
+    Queue(RingRead, 99, in[0], BlockSize, 0, -1);	/* no such file */
+    PrintInt(RingEnter(NumBlocks + 1, NumBlocks + 1));	/* NumBlocks + 1 */
+    PrintInt(Reap());					/* 1 */
+    Close(f);
+
+    for (i = 0; i < NumBlocks; i++)
+	for (j = 0; j < BlockSize; j++)
+	    if (in[i][j] != out[i][j])
+		Exit(1);
+    Halt();
+}
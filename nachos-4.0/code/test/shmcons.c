@@ -0,0 +1,32 @@
+/* shmcons.c
+ *	Consumer half of a simple test of shared memory; run it 
+ *	together with shmprod.
+ *
+ *	Attaches the segment "queue" once the producer has made it,
+ *	waits for the data, and prints its sum, N*(N+1)/2.
+ */
+
+#include "syscall.h"
+
+#define N	200
+
+int
+main()
+{
+    int *queue;
+    int i, sum;
+
+    while ((int) (queue = (int *) ShmAttach("queue")) == -1)
+	Sleep(1);
+    while (queue[0] != 1)
+	Sleep(1);
+
+    sum = 0;
+    for (i = 1; i <= N; i++)
+	sum += queue[i];
+    PrintInt(sum);
+    queue[0] = 2;			/* done with it */
+
+    ShmDetach((int) queue);
+    Exit(0);
+}
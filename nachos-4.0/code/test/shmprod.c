@@ -0,0 +1,32 @@
+/* shmprod.c
+ *	Producer half of a simple test of shared memory; run it 
+ *	together with shmcons.
+ *
+ *	Creates the segment "queue", fills it with the numbers 1..N, 
+ *	and then raises a flag in the segment for the consumer.
+ */
+
+#include "syscall.h"
+
+#define N	200
+
+int
+main()
+{
+    int *queue;
+    int i;
+
+    ShmCreate("queue", (N + 1) * sizeof(int));
+    queue = (int *) ShmAttach("queue");
+    if ((int) queue == -1)
+	Exit(1);
+
+    for (i = 1; i <= N; i++)
+	queue[i] = i;
+    queue[0] = 1;			/* data is ready */
+
+    while (queue[0] != 2)		/* wait for the consumer */
+	Sleep(1);
+    ShmDetach((int) queue);
+    Exit(0);
+}
@@ -146,6 +146,94 @@ Sleep:
 	j	$31
 	.end	Sleep
 
+	.globl  Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu   $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end	Sbrk
+
+	.globl  Mmap
+	.ent	Mmap
+Mmap:
+	addiu   $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end	Mmap
+
+	.globl  Munmap
+	.ent	Munmap
+Munmap:
+	addiu   $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end	Munmap
+
+	.globl  ShmCreate
+	.ent	ShmCreate
+ShmCreate:
+	addiu   $2,$0,SC_ShmCreate
+	syscall
+	j	$31
+	.end	ShmCreate
+
+	.globl  ShmAttach
+	.ent	ShmAttach
+ShmAttach:
+	addiu   $2,$0,SC_ShmAttach
+	syscall
+	j	$31
+	.end	ShmAttach
+
+	.globl  ShmDetach
+	.ent	ShmDetach
+ShmDetach:
+	addiu   $2,$0,SC_ShmDetach
+	syscall
+	j	$31
+	.end	ShmDetach
+
+	.globl  Readv
+	.ent	Readv
+Readv:
+	addiu   $2,$0,SC_Readv
+	syscall
+	j	$31
+	.end	Readv
+
+	.globl  Writev
+	.ent	Writev
+Writev:
+	addiu   $2,$0,SC_Writev
+	syscall
+	j	$31
+	.end	Writev
+
+	.globl  RingSetup
+	.ent	RingSetup
+RingSetup:
+	addiu   $2,$0,SC_RingSetup
+	syscall
+	j	$31
+	.end	RingSetup
+
+	.globl  RingEnter
+	.ent	RingEnter
+RingEnter:
+	addiu   $2,$0,SC_RingEnter
+	syscall
+	j	$31
+	.end	RingEnter
+
+	.globl  Mkdir
+	.ent	Mkdir
+Mkdir:
+	addiu   $2,$0,SC_Mkdir
+	syscall
+	j	$31
+	.end	Mkdir
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,56 @@
+/* writev.c
+ *	Simple program to test the Readv and Writev system calls.
+ *
+ *	Writes a file of small records, several to a Writev, then reads
+ *	it back the same way and checks every record.
+ */
+
+#include "syscall.h"
+
+#define NumRecords	64
+#define RecordSize	12
+#define PerCall		8		/* records per Readv/Writev */
+
+char records[NumRecords][RecordSize];
+char check[NumRecords][RecordSize];
+
+int
+main()
+{
+    IoVec iov[PerCall];
+    OpenFileId f;
+    int i, j, n;
+
+    for (i = 0; i < NumRecords; i++)
+	for (j = 0; j < RecordSize; j++)
+	    records[i][j] = 'A' + (i + j) % 26;
+    Create("writev.out");
+    f = Open("writev.out");
+    for (i = 0, n = 0; i < NumRecords; i += PerCall) {
+	for (j = 0; j < PerCall; j++) {
+	    iov[j].buffer = records[i + j];
+	    iov[j].size = RecordSize;
+	}
+	n += Writev(iov, PerCall, f);
+    }
+    Close(f);
+    PrintInt(n);				/* NumRecords * RecordSize */
+
+    f = Open("writev.out");
+    for (i = 0, n = 0; i < NumRecords; i += PerCall) {
+	for (j = 0; j < PerCall; j++) {
+	    iov[j].buffer = check[i + j];
+	    iov[j].size = RecordSize;
+	}
+	n += Readv(iov, PerCall, f);
+    }
+    PrintInt(n);				/* NumRecords * RecordSize */
+    PrintInt(Readv(iov, MaxIoVecs + 1, f));	/* -1: too many */
+    Close(f);
+
+    for (i = 0; i < NumRecords; i++)
+	for (j = 0; j < RecordSize; j++)
+	    if (check[i][j] != records[i][j])
+		Exit(1);
+    Halt();
+}
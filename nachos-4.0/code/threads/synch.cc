@@ -315,3 +315,97 @@ void Condition::Broadcast(Lock* conditionLock)
         Signal(conditionLock);
     }
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers/writer lock.  Initially, no one holds it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    lock = new Lock("rwlock");
+    okToRead = new Condition("rwlock readers");
+    okToWrite = new Condition("rwlock writers");
+    numReaders = numWaitingWriters = 0;
+    writer = NULL;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	Deallocate a readers/writer lock.  No one may hold it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(numReaders == 0 && writer == NULL);
+    delete okToWrite;
+    delete okToRead;
+    delete lock;
+}
+
+char*
+RWLock::getName()
+{
+	return name;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReadAcquire/ReadRelease
+// 	Enter as one more reader, once no thread is writing or waiting 
+//	to; leave, letting a writer in if we were the last reader.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReadAcquire()
+{
+    lock->Acquire();
+    while (writer != NULL || numWaitingWriters > 0)
+	okToRead->Wait(lock);
+    numReaders++;
+    lock->Release();
+}
+
+void
+RWLock::ReadRelease()
+{
+    lock->Acquire();
+    ASSERT(numReaders > 0);
+    if (--numReaders == 0)
+	okToWrite->Signal(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::WriteAcquire/WriteRelease
+// 	Enter as the only thread holding the lock; leave, letting in the
+//	next writer if there is one, otherwise all the waiting readers.
+//----------------------------------------------------------------------
+
+void
+RWLock::WriteAcquire()
+{
+    lock->Acquire();
+    ASSERT(writer != kernel->currentThread);
+    numWaitingWriters++;
+    while (writer != NULL || numReaders > 0)
+	okToWrite->Wait(lock);
+    numWaitingWriters--;
+    writer = kernel->currentThread;
+    lock->Release();
+}
+
+void
+RWLock::WriteRelease()
+{
+    lock->Acquire();
+    ASSERT(writer == kernel->currentThread);
+    writer = NULL;
+    if (numWaitingWriters > 0)
+	okToWrite->Signal(lock);
+    else
+	okToRead->Broadcast(lock);
+    lock->Release();
+}
@@ -1,8 +1,9 @@
 // synch.h 
 //	Data structures for synchronizing threads.
 //
-//	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
+//	Four kinds of synchronization are defined here: semaphores,
+//	locks, condition variables, and readers/writer locks (built out
+//	of locks and condition variables).  The implementation for
 //	semaphores is given; for the latter two, only the procedure
 //	interface is given -- they are to be implemented as part of 
 //	the first assignment.
@@ -140,4 +141,38 @@ class Condition {
     char* name;
     List<Semaphore *> *waitQueue;	// list of waiting threads
 };
+
+// The following class defines a "readers/writer lock".  Any number of
+// threads may hold it for reading at once, but a thread holding it for
+// writing holds it alone:
+//
+//	ReadAcquire -- wait until no thread is writing, or waiting to 
+//		write, then become one more reader
+//
+//	WriteAcquire -- wait until no thread holds the lock at all
+//
+// Waiting writers keep new readers out, so that a steady stream of
+// readers can't starve them.  A thread must not acquire the lock 
+// again while it holds it, even just for reading.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName();			// debugging assist
+
+    void ReadAcquire();			// share the lock with other readers
+    void ReadRelease();
+    void WriteAcquire();		// have the lock to ourselves
+    void WriteRelease();
+
+  private:
+    char *name;				// debugging assist
+    Lock *lock;				// protects the counts below
+    Condition *okToRead;		// signalled when readers may enter
+    Condition *okToWrite;		// signalled when a writer may enter
+    int numReaders;			// threads holding it for reading
+    int numWaitingWriters;		// threads waiting to write
+    Thread *writer;			// thread holding it for writing
+};
 #endif // SYNCH_H
@@ -20,8 +20,11 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "syscall.h"
+#include "synch.h"
 
 bool AddrSpace::usedPhyPage[NumPhysPages] = {0};
+bool AddrSpace::multiLevel = FALSE;
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -55,6 +58,19 @@ SwapHeader (NoffHeader *noffH)
 
 AddrSpace::AddrSpace()
 {
+    pagingStats = NULL;
+    pageTable = NULL;
+    pageDirectory = NULL;
+    lastLeaf = NULL;
+    lastLeafIndex = 0;
+    numPages = 0;
+    numCommitted = 0;
+    mappedRegions = new List<MappedRegion *>;
+    sharedMappings = new List<SharedMapping *>;
+    for (int i = 0; i < MaxOpenFiles; i++)
+	openFiles[i] = NULL;
+    ring = NULL;
+
     // MemoryManagement
     // The pages required is more than NumPhysPages(32), depending on noffH -> Initial when loading
     /*
@@ -75,18 +91,146 @@ AddrSpace::AddrSpace()
 //    bzero(kernel->machine->mainMemory, MemorySize);
 }
 
+//----------------------------------------------------------------------
+// FreePage
+// 	Give back the frame or swap sector holding a page of an address
+//	space that is going away.  Pages of mapped files and shared
+//	segments have been taken out of the page table already.
+//----------------------------------------------------------------------
+
+static void
+FreePage(TranslationEntry *entry)
+{
+    if (entry->valid) {
+	kernel->frameTable[entry->physicalPage].valid = true;
+	kernel->frameTable[entry->physicalPage].addrspace = NULL;
+	AddrSpace::usedPhyPage[entry->physicalPage] = false;
+    } else if (entry->virtualPage < NumSwapPages) {
+	kernel->swapTable[entry->virtualPage].valid = true;
+	kernel->swapTable[entry->virtualPage].addrspace = NULL;
+    }
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.
+// 	Dealloate an address space: close its files, write back and
+//	unmap its file mappings, detach its shared segments, and give
+//	back its frames and swap sectors.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-   for(int i = 0; i < numPages; i++)
-        AddrSpace::usedPhyPage[pageTable[i].physicalPage] = false;
-   delete pageTable;
+   unsigned int i, j;
+
+   if (ring != NULL)
+	delete ring;			// waits for its requests
+   for (i = 0; i < MaxOpenFiles; i++)
+	if (openFiles[i] != NULL)
+	    delete openFiles[i];
+   while (!mappedRegions->IsEmpty())
+	Unmap(mappedRegions->Front());
+   delete mappedRegions;
+   while (!sharedMappings->IsEmpty())
+	Detach(sharedMappings->Front());
+   delete sharedMappings;
+
+   kernel->memoryManager->lock->Acquire();
+   if (pageDirectory != NULL) {
+	for (i = 0; i < PageDirSize; i++) {
+	    if (pageDirectory[i] == NULL)
+		continue;
+	    for (j = 0; j < PageLeafSize; j++)
+		FreePage(&pageDirectory[i][j]);
+	    delete [] pageDirectory[i];
+	}
+	delete [] pageDirectory;
+   } else if (pageTable != NULL) {
+	for (i = 0; i < numPages; i++)
+	    FreePage(&pageTable[i]);
+	delete [] pageTable;
+   }
+   kernel->memoryManager->Uncommit(numCommitted);
+   kernel->memoryManager->lock->Release();
 }
 
+//----------------------------------------------------------------------
+// InitEntries
+// 	Set "count" page table entries to non-resident pages whose
+//	contents come from "backing" (ZeroFillPage, FileBackedPage, ...).
+//----------------------------------------------------------------------
+
+static void
+InitEntries(TranslationEntry *entry, unsigned int count, unsigned int backing)
+{
+    for (unsigned int i = 0; i < count; i++, entry++) {
+	entry->virtualPage = backing;
+	entry->physicalPage = NumPhysPages;
+	entry->valid = false;
+	entry->use = false;
+	entry->dirty = false;
+	entry->readOnly = false;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitPageTable
+// 	Allocate an empty page table for "numPages" virtual pages.
+//
+//	With a linear page table, that is one entry per page.  With a
+//	two-level page table, we only allocate the page directory here;
+//	leaf tables are allocated by PageEntry as pages get used.  Either
+//	way, every page starts out zero-fill.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitPageTable()
+{
+    ASSERT(numPages <= MaxVirtPages);
+
+    if (multiLevel) {
+	pageTable = NULL;
+	pageDirectory = new TranslationEntry *[PageDirSize];
+	for (unsigned int i = 0; i < PageDirSize; i++)
+	    pageDirectory[i] = NULL;
+    } else {
+	pageDirectory = NULL;
+	pageTable = new TranslationEntry[numPages];
+	InitEntries(pageTable, numPages, ZeroFillPage);
+    }
+    lastLeaf = NULL;
+    lastLeafIndex = 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageEntry
+// 	Return the page table entry for a virtual page.
+//
+//	With two-level page tables, the leaf table holding the entry is
+//	allocated the first time any page in its range is asked for: 
+//	when one of them is faulted in, or mapped.  Until then the pages
+//	are zero-fill, so its entries start out that way.
+//
+//	"vpn" -- the virtual page number
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::PageEntry(unsigned int vpn)
+{
+    TranslationEntry *leaf;
+
+    if (pageDirectory == NULL) {
+	ASSERT(vpn < numPages);
+	return &pageTable[vpn];
+    }
+    ASSERT(vpn < MaxVirtPages);
+    leaf = pageDirectory[vpn >> PageLeafBits];
+    if (leaf == NULL) {
+	leaf = new TranslationEntry[PageLeafSize];
+	InitEntries(leaf, PageLeafSize, ZeroFillPage);
+	pageDirectory[vpn >> PageLeafBits] = leaf;
+    }
+    return &leaf[vpn & (PageLeafSize - 1)];
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::Load
@@ -102,7 +246,7 @@ int AddrSpace::TranalateVir2Phys(int virAddr){
     int ret_physAddr = 0;
     int vpn = (unsigned) virAddr / PageSize;
     int offset = (unsigned) virAddr % PageSize;
-    ret_physAddr = pageTable[vpn].physicalPage * PageSize + offset;
+    ret_physAddr = PageEntry(vpn)->physicalPage * PageSize + offset;
     return ret_physAddr;
 }
 
@@ -110,8 +254,9 @@ bool
 AddrSpace::Load(char *fileName) 
 {
     executable = kernel->fileSystem->Open(fileName);
+    pagingStats = kernel->stats->NewProcessPaging(fileName);
     // NoffHeader noffH;
-    unsigned int size;
+    unsigned int size, loadPages;
 
     if (executable == NULL) {
 	cerr << "Unable to open file " << fileName << "\n";
@@ -129,9 +274,22 @@ AddrSpace::Load(char *fileName)
 						// to leave room for the stack
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
+    heapBreak = size;			// heap starts above the stack
+    // only the code and data come from the file; the rest of the
+    // address space (uninitialized data, stack) is zero-fill
+    loadPages = divRoundUp(noffH.code.size, PageSize);
+    if (noffH.initData.size > 0)
+	loadPages = max(loadPages, divRoundUp(noffH.initData.virtualAddr 
+				+ noffH.initData.size, PageSize));
     DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+    if (!kernel->memoryManager->Commit(numPages)) {
+	cerr << "Not enough swap space for " << fileName << "\n";
+	delete executable;
+	return FALSE;
+    }
+    numCommitted = numPages;
 //	cout << "number of pages of " << fileName<< " is "<<numPages<<endl;
-    pageTable = new TranslationEntry[numPages];
+    InitPageTable();
 
     // Memory management: 
     // Indexing: always i for pageTable, j for frameTable, k for swapTable
@@ -150,22 +308,25 @@ AddrSpace::Load(char *fileName)
     */
 
     int i, j, k;
-    for(i = 0, j = 0; i < numPages && j < NumPhysPages; i++, j++){
+    TranslationEntry *entry;
+    kernel -> memoryManager -> lock -> Acquire(); // no faults till loaded
+    for(i = 0, j = 0; i < loadPages && j < NumPhysPages; i++, j++){
         // use physical frame
         while(kernel -> frameTable[j].valid == false) j++;
         AddrSpace::usedPhyPage[j] = true;
-        pageTable[i].virtualPage = 1024; // VM no need
-        pageTable[i].physicalPage = j; // in physical memory
-        pageTable[i].valid = true; // can be used
-        pageTable[i].use = false;
-        pageTable[i].dirty = false;
-        pageTable[i].readOnly = false;
+        entry = PageEntry(i);
+        entry -> virtualPage = NumSwapPages; // VM no need
+        entry -> physicalPage = j; // in physical memory
+        entry -> valid = true; // can be used
+        entry -> use = false;
+        entry -> dirty = false;
+        entry -> readOnly = false;
         // update frameTable
         kernel -> frameTable[j].valid = false; // occupied
         kernel -> frameTable[j].addrspace = this;
         kernel -> frameTable[j].vpn = i;
     }
-    for(k = 0; i < numPages && k < 1024; i++, k++){
+    for(k = 0; i < loadPages && k < NumSwapPages; i++, k++){
         // use VM: find an available disk segment
         while(kernel -> swapTable[k].valid == false) k++;
 
@@ -175,13 +336,13 @@ AddrSpace::Load(char *fileName)
         kernel-> swapTable[k].vpn = i;
 
         // update pageTable
-        AddrSpace::usedPhyPage[NumPhysPages] = true;
-        pageTable[i].valid = false; // can't be used
-        pageTable[i].virtualPage = k; // in VM
-        pageTable[i].physicalPage = NumPhysPages; // not in physical frame
-        pageTable[i].use = false;
-        pageTable[i].dirty = false;
-        pageTable[i].readOnly = false;
+        entry = PageEntry(i);
+        entry -> valid = false; // can't be used
+        entry -> virtualPage = k; // in VM
+        entry -> physicalPage = NumPhysPages; // not in physical frame
+        entry -> use = false;
+        entry -> dirty = false;
+        entry -> readOnly = false;
     }
     /*
     ASSERT(numPages <= NumPhysPages);		// check we're not trying
@@ -203,14 +364,14 @@ AddrSpace::Load(char *fileName)
         int codePages = divRoundUp(noffH.code.size, PageSize);
         for(i = 0; i < codePages; i++){
             // For each page i, find physical or vm
-            if(pageTable[i].valid){
+            if(PageEntry(i) -> valid){
                 // in physical frame 
                 int physAddr_code = kernel -> memoryManager -> TransAddr(this, i* PageSize);
                 executable -> ReadAt(&(kernel->machine->mainMemory[physAddr_code]), PageSize, noffH.code.inFileAddr+i*PageSize);
             }
             else{
                 // not valid -> in vm
-                int k = pageTable[i].virtualPage;
+                int k = PageEntry(i) -> virtualPage;
                 char *outBuffer = new char[PageSize];
                 executable -> ReadAt(outBuffer, PageSize, noffH.code.inFileAddr+i*PageSize);
                 kernel -> swap -> WriteSector(k, outBuffer); 
@@ -223,15 +384,15 @@ AddrSpace::Load(char *fileName)
     if (noffH.initData.size > 0) {
         DEBUG(dbgAddr, "Initializing data segment.");
 	DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-        for(; i < numPages; i++){
-            if(pageTable[i].valid){
+        for(; i < loadPages; i++){
+            if(PageEntry(i) -> valid){
                 // in physical frame 
                 int physAddr_data = kernel -> memoryManager -> TransAddr(this, i* PageSize);
                 executable -> ReadAt(&(kernel->machine->mainMemory[physAddr_data]), PageSize, noffH.initData.inFileAddr+i*PageSize);
             }
             else{
                 // not valid -> in vm
-                int k = pageTable[i].virtualPage;
+                int k = PageEntry(i) -> virtualPage;
                 char *outBuffer = new char[PageSize];
                 executable -> ReadAt(outBuffer, PageSize, noffH.initData.inFileAddr+i*PageSize);
                 kernel -> swap -> WriteSector(k, outBuffer); 
@@ -240,10 +401,682 @@ AddrSpace::Load(char *fileName)
         int initData_physAddr = TranalateVir2Phys(noffH.initData.virtualAddr);
         executable -> ReadAt(&(kernel->machine->mainMemory[initData_physAddr]), noffH.initData.size, noffH.initData.inFileAddr+i*PageSize);
     }
+    kernel -> memoryManager -> lock -> Release();
     delete executable;			// close file
     return TRUE;			// success
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::GrowPageTable
+// 	Extend the address space to "newPages" pages.  The new pages
+//	are not resident; "backing" says where their contents come
+//	from the first time they are touched (ZeroFillPage or
+//	FileBackedPage).
+//
+//	With two-level page tables, growing the heap touches no leaf
+//	tables at all: pages with no leaf, or past the old end of one,
+//	are zero-fill already.  Only a mapping fills in its entries.
+//
+//	We must be the running address space; the machine is pointed
+//	at the (possibly reallocated) page table.  The memory manager's
+//	lock is held throughout, so that a ring worker of this space
+//	waiting for the disk in the middle of a fault never comes back
+//	to an entry of the old, freed table.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::GrowPageTable(unsigned int newPages, unsigned int backing)
+{
+    unsigned int i;
+
+    ASSERT(newPages <= MaxVirtPages);
+    if (newPages <= numPages)
+	return;
+    kernel->memoryManager->lock->Acquire();
+    if (pageDirectory == NULL) {	// linear page table has to be copied
+	TranslationEntry *newTable = new TranslationEntry[newPages];
+	for (i = 0; i < numPages; i++)
+	    newTable[i] = pageTable[i];
+	InitEntries(&newTable[numPages], newPages - numPages, backing);
+	delete [] pageTable;
+	pageTable = newTable;
+    } else if (backing != ZeroFillPage) {
+	for (i = numPages; i < newPages; i++)
+	    InitEntries(PageEntry(i), 1, backing);
+    }
+    numPages = newPages;
+    kernel->machine->pageTable = pageTable;
+    kernel->machine->pageTableSize = numPages;
+    kernel->memoryManager->lock->Release();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+// 	Grow the heap by "increment" bytes, and return the old end of
+//	the heap, or -1 if the address space can't grow that much.
+//
+//	The heap starts at the end of the image loaded by Load (right
+//	above the user stack) and grows upward.  New pages get neither a
+//	frame nor a swap sector here: they are marked zero-fill, and the
+//	page fault handler hands out a zeroed frame on first touch.
+//
+//	So that eviction can never run out of backing store, each new
+//	page is charged to the swap space first (see Commit); we refuse
+//	to grow once every swap sector has been promised to some page.
+//
+//	"increment" -- number of bytes to add to the heap
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk(int increment)
+{
+    unsigned int oldBreak = heapBreak;
+    unsigned int newPages;
+
+    if (increment < 0)
+	return -1;
+    newPages = divRoundUp(heapBreak + increment, PageSize);
+    if (newPages > numPages) {
+	if (newPages > MaxVirtPages || 
+		!kernel->memoryManager->Commit(newPages - numPages)) {
+	    DEBUG(dbgAddr, "Sbrk of " << increment << " bytes refused");
+	    return -1;
+	}
+	numCommitted += newPages - numPages;
+	GrowPageTable(newPages, ZeroFillPage);
+    }
+    heapBreak += increment;
+    DEBUG(dbgAddr, "Sbrk " << increment << ": break " << oldBreak << " -> " << heapBreak);
+    return oldBreak;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+// 	Map the first "length" bytes of the file "fileName" into the
+//	address space, and return the address of the mapping, or -1 if
+//	the file can't be opened or the address space can't grow.
+//	A "length" of 0 or less, or past the end of the file, maps the
+//	whole file.
+//
+//	The mapping is placed at the next page boundary above the heap,
+//	and the heap continues above it.  Its pages are marked
+//	FileBackedPage: the page fault handler reads them from the file
+//	on first touch, and eviction writes them back to the file if
+//	they are dirty, so they never use swap space.
+//
+//	"fileName" -- the file to map
+//	"length" -- number of bytes to map
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(char *fileName, int length)
+{
+    OpenFile *file;
+    MappedRegion *region;
+    unsigned int firstPage, newPages;
+
+    file = kernel->fileSystem->Open(fileName);
+    if (file == NULL)
+	return -1;
+    if (length <= 0 || length > file->Length())
+	length = file->Length();	// writing back must not grow it
+    firstPage = divRoundUp(heapBreak, PageSize);
+    newPages = firstPage + divRoundUp(length, PageSize);
+    if (length <= 0 || newPages > MaxVirtPages) {
+	delete file;
+	return -1;
+    }
+    GrowPageTable(newPages, FileBackedPage);
+    heapBreak = newPages * PageSize;
+
+    region = new MappedRegion;
+    region->file = file;
+    region->firstPage = firstPage;
+    region->numPages = newPages - firstPage;
+    region->length = length;
+    mappedRegions->Append(region);
+    DEBUG(dbgAddr, "Mmap " << fileName << ", " << length << " bytes at " << firstPage * PageSize);
+    return firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+// 	Remove the mapping starting at "addr", writing its modified
+//	pages back to the file.  Return 0, or -1 if nothing is mapped
+//	at "addr".
+//
+//	The pages stay in the page table, marked UnmappedPage, so that
+//	touching them again is an error.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Munmap(int addr)
+{
+    MappedRegion *region = NULL;
+    ListIterator<MappedRegion *> it(mappedRegions);
+
+    for (; !it.IsDone(); it.Next()) {
+	if ((int)(it.Item()->firstPage * PageSize) == addr) {
+	    region = it.Item();
+	    break;
+	}
+    }
+    if (region == NULL)
+	return -1;
+    Unmap(region);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unmap
+// 	Tear down a mapped region: write back and free its resident
+//	pages, close the file, and forget the region.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Unmap(MappedRegion *region)
+{
+    TranslationEntry *entry;
+    unsigned int i;
+    int j;
+
+    kernel->memoryManager->lock->Acquire();
+    for (i = region->firstPage; i < region->firstPage + region->numPages; i++) {
+	entry = PageEntry(i);
+	if (entry->valid) {
+	    j = entry->physicalPage;
+	    if (entry->dirty)
+		WriteBack(region, i, &(kernel->machine->mainMemory[j * PageSize]));
+	    kernel->frameTable[j].valid = true;
+	    kernel->frameTable[j].addrspace = NULL;
+	    AddrSpace::usedPhyPage[j] = false;
+	}
+	entry->virtualPage = UnmappedPage;
+	entry->physicalPage = NumPhysPages;
+	entry->valid = false;
+	entry->use = false;
+	entry->dirty = false;
+    }
+    mappedRegions->Remove(region);
+    kernel->memoryManager->lock->Release();
+    delete region->file;
+    delete region;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindRegion
+// 	Return the mapped region containing virtual page "vpn", or
+//	NULL if the page is not part of a file mapping.
+//----------------------------------------------------------------------
+
+MappedRegion *
+AddrSpace::FindRegion(unsigned int vpn)
+{
+    ListIterator<MappedRegion *> it(mappedRegions);
+
+    for (; !it.IsDone(); it.Next()) {
+	if (vpn >= it.Item()->firstPage && 
+		vpn < it.Item()->firstPage + it.Item()->numPages)
+	    return it.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadIn
+// 	Fill "into" with the contents of mapped page "vpn", reading it
+//	from the file.  Bytes past the end of the mapping read as zero.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReadIn(MappedRegion *region, unsigned int vpn, char *into)
+{
+    int offset = (vpn - region->firstPage) * PageSize;
+    int numBytes = min((int) PageSize, region->length - offset);
+
+    bzero(into, PageSize);
+    region->file->ReadAt(into, numBytes, offset);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBack
+// 	Write the contents of mapped page "vpn" back to the file.  Only
+//	the bytes inside the mapping are written, so the file never grows.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBack(MappedRegion *region, unsigned int vpn, char *from)
+{
+    int offset = (vpn - region->firstPage) * PageSize;
+    int numBytes = min((int) PageSize, region->length - offset);
+
+    region->file->WriteAt(from, numBytes, offset);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShmAttach
+// 	Attach the shared segment "name" to the address space, and
+//	return its address, or -1 if there is no such segment.
+//
+//	Like a file mapping, the segment goes at the next page boundary
+//	above the heap.  Its pages are marked SharedPage; the page fault
+//	handler points them at the segment's frame, bringing the page
+//	in first if no attached space has it in memory.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::ShmAttach(char *name)
+{
+    SharedSegment *segment = kernel->memoryManager->FindSegment(name);
+    SharedMapping *mapping;
+    unsigned int firstPage;
+
+    if (segment == NULL)
+	return -1;
+    firstPage = divRoundUp(heapBreak, PageSize);
+    if (firstPage + segment->numPages > MaxVirtPages)
+	return -1;
+    GrowPageTable(firstPage + segment->numPages, SharedPage);
+    heapBreak = (firstPage + segment->numPages) * PageSize;
+
+    mapping = new SharedMapping;
+    mapping->segment = segment;
+    mapping->space = this;
+    mapping->firstPage = firstPage;
+    segment->mappings->Append(mapping);
+    sharedMappings->Append(mapping);
+    DEBUG(dbgAddr, "ShmAttach " << name << " at " << firstPage * PageSize);
+    return firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShmDetach
+// 	Detach the shared segment attached at "addr".  Return 0, or -1
+//	if no segment is attached there.  The segment goes away when the
+//	last address space detaches it.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::ShmDetach(int addr)
+{
+    ListIterator<SharedMapping *> it(sharedMappings);
+
+    for (; !it.IsDone(); it.Next()) {
+	if ((int)(it.Item()->firstPage * PageSize) == addr) {
+	    Detach(it.Item());
+	    return 0;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Detach
+// 	Remove a shared segment from the page table.  A resident page
+//	stays in its frame for the other attached spaces; if the frame
+//	table names us as its owner, ownership moves to one of them.
+//	Their own entries need not point at the frame yet; whoever
+//	evicts it finds the frame through the segment.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::Detach(SharedMapping *mapping)
+{
+    SharedSegment *segment = mapping->segment;
+    SharedMapping *other;
+    TranslationEntry *entry, *shared;
+    unsigned int p;
+    int j;
+
+    kernel->memoryManager->lock->Acquire();
+    segment->mappings->Remove(mapping);
+    sharedMappings->Remove(mapping);
+    for (p = 0; p < segment->numPages; p++) {
+	entry = PageEntry(mapping->firstPage + p);
+	shared = &segment->pages[p];
+	if (shared->valid) {
+	    shared->dirty = shared->dirty || entry->dirty;
+	    j = shared->physicalPage;
+	    if (kernel->frameTable[j].addrspace == this && 
+			!segment->mappings->IsEmpty()) {
+		other = segment->mappings->Front();
+		kernel->frameTable[j].addrspace = other->space;
+		kernel->frameTable[j].vpn = other->firstPage + p;
+	    }
+	}
+	entry->virtualPage = UnmappedPage;
+	entry->physicalPage = NumPhysPages;
+	entry->valid = false;
+	entry->use = false;
+	entry->dirty = false;
+    }
+    if (segment->mappings->IsEmpty())
+	kernel->memoryManager->DestroySegment(segment);
+    kernel->memoryManager->lock->Release();
+    delete mapping;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindShared
+// 	Return the attached segment containing virtual page "vpn", or
+//	NULL if the page is not shared.
+//----------------------------------------------------------------------
+
+SharedMapping *
+AddrSpace::FindShared(unsigned int vpn)
+{
+    ListIterator<SharedMapping *> it(sharedMappings);
+
+    for (; !it.IsDone(); it.Next()) {
+	if (vpn >= it.Item()->firstPage && 
+		vpn < it.Item()->firstPage + it.Item()->segment->numPages)
+	    return it.Item();
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SharedEntry
+// 	Return the shared segment's own page table entry for our
+//	virtual page "vpn", or NULL if "vpn" is not part of a segment.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+AddrSpace::SharedEntry(unsigned int vpn)
+{
+    SharedMapping *mapping = FindShared(vpn);
+
+    if (mapping == NULL)
+	return NULL;
+    return &mapping->segment->pages[vpn - mapping->firstPage];
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+// 	Make a shared segment of "size" bytes.  Its pages start out
+//	zero-fill, like new heap pages.
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(char *segName, int size)
+{
+    name = new char[strlen(segName) + 1];
+    strcpy(name, segName);
+    numPages = divRoundUp(size, PageSize);
+    pages = new TranslationEntry[numPages];
+    for (unsigned int p = 0; p < numPages; p++) {
+	pages[p].virtualPage = ZeroFillPage;
+	pages[p].physicalPage = NumPhysPages;
+	pages[p].valid = false;
+	pages[p].use = false;
+	pages[p].dirty = false;
+	pages[p].readOnly = false;
+    }
+    mappings = new List<SharedMapping *>;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::~SharedSegment
+// 	Give back the frames and swap sectors of the segment.  Nothing
+//	may have it attached any more.
+//----------------------------------------------------------------------
+
+SharedSegment::~SharedSegment()
+{
+    ASSERT(mappings->IsEmpty());
+    for (unsigned int p = 0; p < numPages; p++) {
+	if (pages[p].valid) {
+	    kernel->frameTable[pages[p].physicalPage].valid = true;
+	    kernel->frameTable[pages[p].physicalPage].addrspace = NULL;
+	    AddrSpace::usedPhyPage[pages[p].physicalPage] = false;
+	} else if (pages[p].virtualPage < NumSwapPages) {
+	    kernel->swapTable[pages[p].virtualPage].valid = true;
+	    kernel->swapTable[pages[p].virtualPage].addrspace = NULL;
+	}
+    }
+    delete mappings;
+    delete [] pages;
+    delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::IsDirty
+// 	Return TRUE if resident page "page" was modified through any
+//	of the address spaces attaching it.
+//----------------------------------------------------------------------
+
+bool
+SharedSegment::IsDirty(unsigned int page)
+{
+    ListIterator<SharedMapping *> it(mappings);
+
+    if (pages[page].dirty)
+	return TRUE;
+    for (; !it.IsDone(); it.Next()) {
+	if (it.Item()->space->PageEntry(it.Item()->firstPage + page)->dirty)
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::Invalidate
+// 	Page "page" has been evicted: make every attached address space
+//	fault on it again, so that they find it wherever it went.
+//----------------------------------------------------------------------
+
+void
+SharedSegment::Invalidate(unsigned int page)
+{
+    ListIterator<SharedMapping *> it(mappings);
+    TranslationEntry *entry;
+
+    for (; !it.IsDone(); it.Next()) {
+	entry = it.Item()->space->PageEntry(it.Item()->firstPage + page);
+	entry->virtualPage = SharedPage;
+	entry->physicalPage = NumPhysPages;
+	entry->valid = false;
+	entry->use = false;
+	entry->dirty = false;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+// 	Copy a null-terminated string from user virtual address
+//	"virtAddr" into the kernel buffer "into", faulting pages in as
+//	needed.  Return FALSE if the string runs off the end of the
+//	address space, or doesn't fit in "size" bytes.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyInString(int virtAddr, char *into, int size)
+{
+    TranslationEntry *entry;
+    unsigned int vpn;
+
+    for (int n = 0; n < size; n++, virtAddr++) {
+	vpn = (unsigned) virtAddr / PageSize;
+	if (virtAddr < 0 || vpn >= numPages)
+	    return FALSE;
+	entry = PageEntry(vpn);
+	while (!entry->valid) {		// another thread may evict it again
+	    if (!kernel->memoryManager->PageFaultHandler(vpn))
+		return FALSE;		// unmapped by Munmap
+	    entry = PageEntry(vpn);	// the table may have grown meanwhile
+	}
+	entry->use = TRUE;
+	into[n] = kernel->machine->mainMemory[entry->physicalPage * PageSize 
+				+ (unsigned) virtAddr % PageSize];
+	if (into[n] == '\0')
+	    return TRUE;
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// 	Copy "size" bytes from user virtual address "virtAddr" into the
+//	kernel buffer "into", faulting pages in as needed.  Each page is
+//	translated once, and its part of the buffer copied all at once.
+//	Return FALSE if the buffer runs off the end of the address space,
+//	or into a page that has been unmapped.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyIn(int virtAddr, char *into, int size)
+{
+    TranslationEntry *entry;
+    unsigned int vpn, offset;
+    int count;
+
+    for (; size > 0; virtAddr += count, into += count, size -= count) {
+	vpn = (unsigned) virtAddr / PageSize;
+	offset = (unsigned) virtAddr % PageSize;
+	if (virtAddr < 0 || vpn >= numPages)
+	    return FALSE;
+	count = min(size, (int) (PageSize - offset));
+	entry = PageEntry(vpn);
+	while (!entry->valid) {
+	    if (!kernel->memoryManager->PageFaultHandler(vpn))
+		return FALSE;
+	    entry = PageEntry(vpn);
+	}
+	entry->use = TRUE;
+	bcopy(&kernel->machine->mainMemory[entry->physicalPage * PageSize 
+					+ offset], into, count);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOut
+// 	Copy "size" bytes from the kernel buffer "from" to user virtual
+//	address "virtAddr", a page at a time, as CopyIn does.  Return 
+//	FALSE if the buffer runs off the end of the address space, or
+//	into a read-only or unmapped page; the pages before it have been
+//	written.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOut(char *from, int virtAddr, int size)
+{
+    TranslationEntry *entry;
+    unsigned int vpn, offset;
+    int count;
+
+    for (; size > 0; virtAddr += count, from += count, size -= count) {
+	vpn = (unsigned) virtAddr / PageSize;
+	offset = (unsigned) virtAddr % PageSize;
+	if (virtAddr < 0 || vpn >= numPages)
+	    return FALSE;
+	count = min(size, (int) (PageSize - offset));
+	entry = PageEntry(vpn);
+	if (entry->readOnly)
+	    return FALSE;
+	while (!entry->valid) {
+	    if (!kernel->memoryManager->PageFaultHandler(vpn))
+		return FALSE;
+	    entry = PageEntry(vpn);
+	}
+	entry->use = TRUE;
+	entry->dirty = TRUE;
+	bcopy(from, &kernel->machine->mainMemory[entry->physicalPage * PageSize
+					+ offset], count);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddFile
+// 	Enter "file" in the table of open files, and return its 
+//	OpenFileId, or -1 if there is no room left.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddFile(OpenFile *file)
+{
+    for (int id = ConsoleOutput + 1; id < MaxOpenFiles; id++) {
+	if (openFiles[id] == NULL) {
+	    openFiles[id] = file;
+	    return id;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetFile
+// 	Return the open file with OpenFileId "id", or NULL if there is
+//	none (the console isn't in the table).
+//----------------------------------------------------------------------
+
+OpenFile *
+AddrSpace::GetFile(int id)
+{
+    if (id < 0 || id >= MaxOpenFiles)
+	return NULL;
+    return openFiles[id];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CloseFile
+// 	Close the open file with OpenFileId "id", freeing the id.  
+//	Return FALSE if there is no such file.  Requests on the ring
+//	may be using the file, so we wait for them first.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CloseFile(int id)
+{
+    OpenFile *file = GetFile(id);
+
+    if (file == NULL)
+	return FALSE;
+    if (ring != NULL)
+	ring->Drain();
+    delete file;
+    openFiles[id] = NULL;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetupRing
+// 	Start using the Ring at user address "addr" for asynchronous 
+//	requests.  Return 0, or -1 if there is a ring already, or the
+//	ring isn't all in writable, word-aligned user memory.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::SetupRing(int addr)
+{
+    unsigned int vpn;
+
+    if (ring != NULL || addr < 0 || addr % sizeof(int) != 0 ||
+		(unsigned) addr + IoRing::Size() > numPages * PageSize)
+	return -1;
+    for (vpn = addr / PageSize; 
+		vpn <= (addr + IoRing::Size() - 1) / PageSize; vpn++)
+	if (PageEntry(vpn)->readOnly)
+	    return -1;
+    ring = new IoRing(this, addr);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EnterRing
+// 	Submit up to "toSubmit" requests on the ring, and wait for at 
+//	least "minComplete" completions (see IoRing::Enter).  Return
+//	how many were submitted, or -1 if there is no ring.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::EnterRing(int toSubmit, int minComplete)
+{
+    if (ring == NULL)
+	return -1;
+    return ring->Enter(toSubmit, minComplete);
+}
+
 //----------------------------------------------------------------------
 // AddrSpace::Execute
 // 	Run a user program.  Load the executable into memory, then
@@ -315,8 +1148,10 @@ AddrSpace::InitRegisters()
 
 void AddrSpace::SaveState() 
 {
-        pageTable=kernel->machine->pageTable;
-        numPages=kernel->machine->pageTableSize;
+    // the page table itself belongs to us; the machine only caches
+    // which leaf table it used last
+    lastLeaf = kernel->machine->lastLeaf;
+    lastLeafIndex = kernel->machine->lastLeafIndex;
 }
 
 //----------------------------------------------------------------------
@@ -330,19 +1165,54 @@ void AddrSpace::SaveState()
 void AddrSpace::RestoreState() 
 {
     kernel->machine->pageTable = pageTable;
+    kernel->machine->pageDirectory = pageDirectory;
     kernel->machine->pageTableSize = numPages;
+    kernel->machine->lastLeaf = lastLeaf;
+    kernel->machine->lastLeafIndex = lastLeafIndex;
 }
 
 MemoryManager::MemoryManager(VictimType v){
     vicType = v;
+    segments = new List<SharedSegment *>;
+    committed = 0;
+    lock = new Lock("memory manager");
+}
+
+int MemoryManager::CreateSegment(char *name, int size){
+    // make a new named shared segment, return 0 or -1
+    if(size <= 0 || FindSegment(name) != NULL)
+        return -1;
+    if(!Commit(divRoundUp(size, PageSize)))
+        return -1; // must be able to swap all of it out
+    segments -> Append(new SharedSegment(name, size));
+    DEBUG(dbgAddr, "CREATE SHARED SEGMENT " << name << ", " << size << " bytes");
+    return 0;
+}
+
+SharedSegment *MemoryManager::FindSegment(char *name){
+    ListIterator<SharedSegment *> it(segments);
+    for(; !it.IsDone(); it.Next()){
+        if(strcmp(it.Item() -> name, name) == 0)
+            return it.Item();
+    }
+    return NULL;
+}
+
+void MemoryManager::DestroySegment(SharedSegment *segment){
+    // last process detached it
+    DEBUG(dbgAddr, "DESTROY SHARED SEGMENT " << segment -> name);
+    segments -> Remove(segment);
+    Uncommit(segment -> numPages);
+    delete segment;
 }
 
 int MemoryManager::TransAddr(AddrSpace *space, int virAddr){
     int physAddr = 0;
     int vpn = (unsigned) virAddr / PageSize;
     int offset = (unsigned) virAddr % PageSize;
-    ASSERT(space -> pageTable[vpn].valid); // should be valid before translation
-    physAddr = space -> pageTable[vpn].physicalPage * PageSize + offset;
+    TranslationEntry *entry = space -> PageEntry(vpn);
+    ASSERT(entry -> valid); // should be valid before translation
+    physAddr = entry -> physicalPage * PageSize + offset;
     return physAddr;
 }
 
@@ -352,7 +1222,14 @@ bool MemoryManager::AcquirePage(AddrSpace *space, int vpn){
     // Assume there already has empty frame!
     FrameInfoEntry *frameTable = kernel -> frameTable;
     FrameInfoEntry *swapTable = kernel -> swapTable;
-    int k = space -> pageTable[vpn].virtualPage; // index for swap table
+    TranslationEntry *entry = space -> PageEntry(vpn);
+    int k = entry -> virtualPage; // index for swap table
+    TranslationEntry *shared = NULL;
+    if(k == SharedPage){
+        // shared segment: the segment knows where the page is
+        shared = space -> SharedEntry(vpn);
+        k = shared -> virtualPage;
+    }
     for(int j = 0; j < NumPhysPages; j++){
         // find an available physical frame
         if(frameTable[j].valid == true){
@@ -364,22 +1241,43 @@ bool MemoryManager::AcquirePage(AddrSpace *space, int vpn){
             frameTable[j].usageCount = 0;
             frameTable[j].latestTick = kernel -> stats -> totalTicks;
 
-            // copy data from VM to frame
-            char *inBuffer = new char[PageSize];
-            kernel -> swap -> ReadSector(k, inBuffer);
-            bcopy(inBuffer, &(kernel -> machine -> mainMemory[j*PageSize]), PageSize);
+            if(k == ZeroFillPage){
+                // never touched before: hand out a zeroed frame
+                bzero(&(kernel -> machine -> mainMemory[j*PageSize]), PageSize);
+            }
+            else if(k == FileBackedPage){
+                // mapped file: read the page from the file itself
+                space -> ReadIn(space -> FindRegion(vpn), vpn, &(kernel -> machine -> mainMemory[j*PageSize]));
+            }
+            else{
+                // copy data from VM to frame
+                char *inBuffer = new char[PageSize];
+                kernel -> swap -> ReadSector(k, inBuffer);
+                bcopy(inBuffer, &(kernel -> machine -> mainMemory[j*PageSize]), PageSize);
+                kernel -> stats -> paging -> numSwapIns++;
+                space -> pagingStats -> numSwapIns++;
+                delete[] inBuffer;
+
+                // update swap table
+                swapTable[k].addrspace = NULL;
+                swapTable[k].valid = true;
+            }
+            // we may have waited for the disk: look the entry up again
+            entry = space -> PageEntry(vpn);
 
             // update page table
-            space -> pageTable[vpn].virtualPage = 1024;
-            space -> pageTable[vpn].physicalPage = j;
-            space -> pageTable[vpn].valid = true;
+            entry -> virtualPage = NumSwapPages;
+            entry -> physicalPage = j;
+            entry -> valid = true;
+            entry -> use = false;
+            entry -> dirty = false;
             AddrSpace::usedPhyPage[j] = true;
-
-            // update swap table
-            swapTable[k].addrspace = NULL;
-            swapTable[k].valid = true;
-
-            delete[] inBuffer;
+            if(shared != NULL){
+                shared -> virtualPage = NumSwapPages;
+                shared -> physicalPage = j;
+                shared -> valid = true;
+                shared -> dirty = false;
+            }
 
             DEBUG(dbgAddr, "OCCUPIED PHYSICAL FRAME" << j); 
             return true;
@@ -395,19 +1293,76 @@ bool MemoryManager::ReleasePage(AddrSpace *space, int vpn){
     // Swap out: from frame to disk
     FrameInfoEntry *frameTable = kernel -> frameTable;
     FrameInfoEntry *swapTable = kernel -> swapTable;
-    int j = space -> pageTable[vpn].physicalPage;
-    for(int k = 0; k < 1024; k++){
+    TranslationEntry *entry = space -> PageEntry(vpn);
+    SharedMapping *mapping = space -> FindShared(vpn);
+    // a shared page's frame is kept by the segment: the owner's own
+    // entry may not point at it (see AddrSpace::Detach)
+    int j = (mapping != NULL) ? mapping -> segment -> pages[vpn - mapping -> firstPage].physicalPage
+                              : entry -> physicalPage;
+    ASSERT((unsigned) j < NumPhysPages);
+    MappedRegion *region = space -> FindRegion(vpn);
+    if(region != NULL){
+        // mapped file: the file is the backing store, no swap needed
+        if(entry -> dirty){
+            space -> WriteBack(region, vpn, &(kernel -> machine -> mainMemory[j*PageSize]));
+            kernel -> stats -> paging -> numDirtyEvictions++;
+            space -> pagingStats -> numDirtyEvictions++;
+            entry = space -> PageEntry(vpn); // we waited for the disk
+        }
+        else{
+            kernel -> stats -> paging -> numCleanEvictions++;
+            space -> pagingStats -> numCleanEvictions++;
+        }
+
+        // update page table
+        entry -> valid = false;
+        entry -> virtualPage = FileBackedPage;
+        entry -> physicalPage = NumPhysPages;
+
+        // update frame table
+        frameTable[j].valid = true;
+        frameTable[j].addrspace = NULL;
+        frameTable[j].latestTick = 0;
+        AddrSpace::usedPhyPage[j] = false;
+        DEBUG(dbgAddr, "RELEASE FRAME " << j << " TO MAPPED FILE");
+        return true;
+    }
+    for(int k = 0; k < NumSwapPages; k++){
        if(swapTable[k].valid == true){
+            // statistics: was the page modified since it was brought in?
+            bool dirty = entry -> dirty;
+            if(mapping != NULL)
+                dirty = mapping -> segment -> IsDirty(vpn - mapping -> firstPage);
+            if(dirty){
+                kernel -> stats -> paging -> numDirtyEvictions++;
+                space -> pagingStats -> numDirtyEvictions++;
+            }
+            else{
+                kernel -> stats -> paging -> numCleanEvictions++;
+                space -> pagingStats -> numCleanEvictions++;
+            }
+            kernel -> stats -> paging -> numSwapOuts++;
+            space -> pagingStats -> numSwapOuts++;
+
             // update swap table
             swapTable[k].valid = false;
             swapTable[k].addrspace = space;
             swapTable[k].vpn = vpn;
 
             // update page table
-            space -> pageTable[vpn].valid = false;
-            space -> pageTable[vpn].virtualPage = k;
-            space -> pageTable[vpn].physicalPage = NumPhysPages;
-            AddrSpace::usedPhyPage[NumPhysPages] = true;
+            if(mapping != NULL){
+                // shared page: swapped out once for everybody
+                TranslationEntry *shared = &(mapping -> segment -> pages[vpn - mapping -> firstPage]);
+                shared -> valid = false;
+                shared -> virtualPage = k;
+                shared -> physicalPage = NumPhysPages;
+                mapping -> segment -> Invalidate(vpn - mapping -> firstPage);
+            }
+            else{
+                entry -> valid = false;
+                entry -> virtualPage = k;
+                entry -> physicalPage = NumPhysPages;
+            }
 
             // copy data from frame to disk 
             char *outBuffer = new char[PageSize];
@@ -427,28 +1382,64 @@ bool MemoryManager::ReleasePage(AddrSpace *space, int vpn){
             return true;
        }
     }
-    // Exceed 1024 sectors, return false to indicate
+    // Exceed NumSwapPages sectors, return false to indicate
     DEBUG(dbgAddr, "EXCEED DISK SECTORS");
     return false;
 }
 
-void MemoryManager::PageFaultHandler(int faultPageNum){
+bool MemoryManager::PageFaultHandler(int faultPageNum){
     DEBUG(dbgAddr, "HANDLING");
     // Invoke when page fault occurs
+    // One fault at a time: ring workers fault in pages of the same
+    // address space as its program, and a fault may wait for the disk
+    // half way through changing the frame and swap tables
+    lock -> Acquire();
+    TranslationEntry *entry;
+    entry = kernel -> currentThread -> space -> PageEntry(faultPageNum);
+    if(entry -> valid){
+        // another thread brought it in while we waited for the lock
+        lock -> Release();
+        return true;
+    }
     // update page fault info and LRU, LFU data
     kernel -> stats -> numPageFaults++;
-    TranslationEntry *entry;
-    entry = &kernel -> machine -> pageTable[faultPageNum];
+    int startTick = kernel -> stats -> totalTicks; // fault service time
     unsigned int pageFrame = entry -> physicalPage;
-    kernel -> frameTable[pageFrame].usageCount++;
-    kernel -> frameTable[pageFrame].latestTick = kernel -> stats -> totalTicks;
+    if(pageFrame < NumPhysPages){
+        kernel -> frameTable[pageFrame].usageCount++;
+        kernel -> frameTable[pageFrame].latestTick = kernel -> stats -> totalTicks;
+    }
 
     // Exchange between frameTable <-> swapTable
-    TranslationEntry *pageTable = kernel -> currentThread -> space -> pageTable;
     FrameInfoEntry *frameTable = kernel -> frameTable;
     FrameInfoEntry *swapTable = kernel -> swapTable;
 
-    int k = pageTable[faultPageNum].virtualPage; // target
+    int k = entry -> virtualPage; // target
+    if(k == UnmappedPage){
+        // touched memory after Munmap: the caller ends the process
+        DEBUG(dbgAddr, "UNMAPPED PAGE " << faultPageNum);
+        lock -> Release();
+        return false;
+    }
+    if(k == SharedPage){
+        TranslationEntry *shared = kernel -> currentThread -> space -> SharedEntry(faultPageNum);
+        if(shared -> valid){
+            // another process already brought the page in: share its frame
+            entry -> physicalPage = shared -> physicalPage;
+            entry -> valid = true;
+            entry -> use = false;
+            entry -> dirty = false;
+            kernel -> frameTable[shared -> physicalPage].usageCount++;
+            kernel -> frameTable[shared -> physicalPage].latestTick = kernel -> stats -> totalTicks;
+
+            int faultTicks = kernel -> stats -> totalTicks - startTick;
+            kernel -> stats -> paging -> RecordFault(faultTicks, FALSE);
+            kernel -> currentThread -> space -> pagingStats -> RecordFault(faultTicks, FALSE);
+            lock -> Release();
+            return true;
+        }
+        k = shared -> virtualPage;
+    }
 
     while(AcquirePage(kernel -> currentThread -> space, faultPageNum) == false){
         // while AquirePage return false: No available physical frame
@@ -459,6 +1450,45 @@ void MemoryManager::PageFaultHandler(int faultPageNum){
         bool releaseSuccess = ReleasePage(addr_vic, vpn_vic);
         ASSERT(releaseSuccess);
     }
+
+    // statistics: a page read back from swap or a file is a major
+    // fault, a zero-fill page is a minor one
+    int faultTicks = kernel -> stats -> totalTicks - startTick;
+    bool major = (k != ZeroFillPage);
+    kernel -> stats -> paging -> RecordFault(faultTicks, major);
+    kernel -> currentThread -> space -> pagingStats -> RecordFault(faultTicks, major);
+    kernel -> stats -> SampleOccupancy(NumUsedFrames());
+    lock -> Release();
+    return true;
+}
+
+bool MemoryManager::Commit(int pages){
+    // Every page of a program, its heap, or a shared segment may have
+    // to be swapped out some day.  Counting free swap sectors is not
+    // enough, since pages that have never been evicted don't hold one
+    // yet: instead, promise one to each page up front, and refuse once
+    // all of them are promised.  Mapped file pages need none.
+    if(committed + pages > NumSwapPages){
+        DEBUG(dbgAddr, "COMMIT OF " << pages << " PAGES REFUSED, " << committed << " COMMITTED");
+        return false;
+    }
+    committed += pages;
+    return true;
+}
+
+void MemoryManager::Uncommit(int pages){
+    committed -= pages;
+    ASSERT(committed >= 0);
+}
+
+int MemoryManager::NumUsedFrames(){
+    // count frames holding a page of some process
+    int used = 0;
+    for(int j = 0; j < NumPhysPages; j++){
+        if(kernel -> frameTable[j].valid == false)
+            used++;
+    }
+    return used;
 }
 
 int MemoryManager::ChooseVictim(){
@@ -467,10 +1497,12 @@ int MemoryManager::ChooseVictim(){
     // input: method of choosing victim
     // output: index j, indicate victim for frameTable
     int ret_j = -1; // index for victim
+    int scanned = NumPhysPages; // frames examined, for statistics
 
     if(kernel -> memoryManager -> vicType == Random){
        // random
        ret_j = rand()%32;
+       scanned = 1;
        // DEBUG(dbgPage, "RANDOM SWAPOUT" << ret_j); 
     }
     else if(kernel -> memoryManager -> vicType == LRU){
@@ -519,5 +1551,10 @@ int MemoryManager::ChooseVictim(){
         // DEBUG(dbgPage, "ELSE SWAPOUT");
     }
     // kernel -> stats -> frameStat[ret_j]++;
+    kernel -> stats -> paging -> numVictimSelections++;
+    kernel -> stats -> paging -> numVictimScans += scanned;
+    AddrSpace *faulting = kernel -> currentThread -> space;
+    faulting -> pagingStats -> numVictimSelections++;
+    faulting -> pagingStats -> numVictimScans += scanned;
     return ret_j;
 }
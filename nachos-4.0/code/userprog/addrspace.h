@@ -18,8 +18,79 @@
 #include <string.h>
 
 #include "noff.h" // for memory management
+#include "stats.h"
+#include "list.h"
+#include "ioring.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define NumSwapPages		1024	// pages of backing store in SWAPSPACE;
+					// also used in a page table entry's
+					// virtualPage to mean "no swap slot"
+#define ZeroFillPage		(NumSwapPages + 1)
+					// virtualPage of a page that has never
+					// been touched: no frame, no swap sector,
+					// zero-filled on its first page fault
+#define FileBackedPage		(NumSwapPages + 2)
+					// virtualPage of a non-resident page of
+					// a mapped file: read from the file
+#define UnmappedPage		(NumSwapPages + 3)
+					// virtualPage of a page whose file
+					// mapping was removed: touching it
+					// is an error
+#define SharedPage		(NumSwapPages + 4)
+					// virtualPage of a non-resident page of
+					// an attached shared segment: where the
+					// page really is is kept by the segment
+
+#define MaxOpenFiles		16	// open files per address space,
+					// counting the console (ids 0 and 1)
+
+// A file mapped into an address space by Mmap.  Its pages are
+// firstPage .. firstPage+numPages-1; page i holds the file bytes
+// starting at (i - firstPage) * PageSize.
+
+class MappedRegion {
+  public:
+    OpenFile *file;			// the mapped file, open while mapped
+    unsigned int firstPage;		// first virtual page of the mapping
+    unsigned int numPages;		// pages in the mapping
+    int length;				// bytes of the file mapped
+};
+
+// A named shared memory segment (see ShmCreate in syscall.h).  
+// "pages" is the segment's own page table, using the same conventions
+// as an address space's: each page is in one frame or one swap sector
+// no matter how many address spaces have it attached, and an attached
+// page table entry only points at the frame while the page is resident.
+
+class AddrSpace;
+class SharedMapping;
+class Lock;
+
+class SharedSegment {
+  public:
+    SharedSegment(char *segName, int size);
+    ~SharedSegment();			// free the frames and swap sectors
+
+    char *name;				// name given to ShmCreate
+    unsigned int numPages;		// size of the segment, in pages
+    TranslationEntry *pages;		// where each page lives
+    List<SharedMapping *> *mappings;	// address spaces attaching it
+
+    bool IsDirty(unsigned int page);	// modified through any mapping?
+    void Invalidate(unsigned int page);	// page left memory: unmap it
+					// from every attached space
+};
+
+// One attachment of a shared segment, at virtual pages
+// firstPage .. firstPage+segment->numPages-1 of "space".
+
+class SharedMapping {
+  public:
+    SharedSegment *segment;
+    AddrSpace *space;
+    unsigned int firstPage;
+};
 
 // Specify victim
 enum VictimType {
@@ -39,18 +110,89 @@ class AddrSpace {
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
     static bool usedPhyPage[NumPhysPages];
+    static bool multiLevel;		// use two-level page tables?
+
+    TranslationEntry *PageEntry(unsigned int vpn);
+					// Page table entry for virtual page
+					// "vpn", whichever page table
+					// representation is in use
+    unsigned int NumPages() { return numPages; }
+
+    int Sbrk(int increment);		// Grow the heap by "increment" bytes;
+					// return the old break, or -1
+    int Mmap(char *fileName, int length);
+					// Map a file; return its address or -1
+    int Munmap(int addr);		// Remove the mapping at "addr"
+
+    bool CopyInString(int virtAddr, char *into, int size);
+					// Fetch a string argument of a
+					// system call from user memory
+    bool CopyIn(int virtAddr, char *into, int size);
+    bool CopyOut(char *from, int virtAddr, int size);
+					// Move a system call's buffer 
+					// from/to user memory
+
+    int AddFile(OpenFile *file);	// Give an open file an OpenFileId;
+					// -1 if the table is full
+    OpenFile *GetFile(int id);		// The open file "id", or NULL
+    bool CloseFile(int id);		// Close it; FALSE if it isn't open
+
+    int SetupRing(int addr);		// Register the Ring at "addr"; 0, 
+					// or -1 if it can't be used
+    int EnterRing(int toSubmit, int minComplete);
+					// Submit requests on the ring, and
+					// wait for completions; -1 if none
+
+    int ShmAttach(char *name);		// Map a shared segment; return its
+					// address or -1
+    int ShmDetach(int addr);		// Remove the segment at "addr"
+    SharedMapping *FindShared(unsigned int vpn);
+					// Attached segment holding page "vpn"
+    TranslationEntry *SharedEntry(unsigned int vpn);
+					// The segment's entry for page "vpn",
+					// or NULL if it is not shared
+
+    MappedRegion *FindRegion(unsigned int vpn);
+					// Mapped region holding page "vpn"
+    void ReadIn(MappedRegion *region, unsigned int vpn, char *into);
+    void WriteBack(MappedRegion *region, unsigned int vpn, char *from);
+					// Move a mapped page from/to its file
 
     // Change to public
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
+    TranslationEntry *pageTable;	// Linear page table translation,
+					// NULL if multiLevel
 
     // Since noffH and executable have to be used later, to copy data into mainMemory
     NoffHeader noffH;
     OpenFile *executable;
 
+    PagingStats *pagingStats;		// paging counters of this process
+
   private:
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    unsigned int heapBreak;		// First byte past the end of the heap
+    int numCommitted;			// Pages charged to the swap space
+					// (see MemoryManager::Commit)
+    List<MappedRegion *> *mappedRegions;	// Files mapped by Mmap
+    List<SharedMapping *> *sharedMappings;	// Segments attached
+    OpenFile *openFiles[MaxOpenFiles];	// Files opened by Open, by
+					// OpenFileId; 0 and 1 are the
+					// console, so never used
+    IoRing *ring;			// Asynchronous requests, or NULL
+    TranslationEntry **pageDirectory;	// Two-level page table, if multiLevel
+    unsigned int lastLeafIndex;		// The machine's cache of the last
+    TranslationEntry *lastLeaf;		// leaf table used, saved across
+					// context switches
+
+    void GrowPageTable(unsigned int newPages, unsigned int backing);
+					// Add non-resident pages to the
+					// end of the address space
+    void Unmap(MappedRegion *region);	// Write back and drop a mapping
+    void Detach(SharedMapping *mapping);	// Drop a shared segment
+
+    void InitPageTable();		// Allocate an empty page table
+					// covering "numPages" pages
 
     bool Load(char *fileName);		// Load the program into memory
 					// return false if not found
@@ -75,13 +217,32 @@ class FrameInfoEntry{
 class MemoryManager{
   public:
     VictimType vicType;
+    Lock *lock;				// held while frames and swap sectors
+					// change hands; a fault can wait for
+					// the disk in the middle
     MemoryManager(VictimType v);
     int TransAddr(AddrSpace *space, int virAddr);
     bool AcquirePage(AddrSpace *space, int vpn);
     bool ReleasePage(AddrSpace *space, int vpn);
-    void PageFaultHandler(int faultPageNum);
+    bool PageFaultHandler(int faultPageNum);
+					// Bring in a page; FALSE if it
+					// was unmapped
     
     int ChooseVictim();
+    int NumUsedFrames();		// physical frames currently in use
+    bool Commit(int pages);		// Promise a swap sector to "pages"
+					// more pages; FALSE if there are
+					// not that many left to promise
+    void Uncommit(int pages);		// Take the promise back
+
+    int CreateSegment(char *name, int size);
+					// Make a new shared segment
+    SharedSegment *FindSegment(char *name);
+    void DestroySegment(SharedSegment *segment);
+
+  private:
+    List<SharedSegment *> *segments;	// all shared segments, by name
+    int committed;			// pages promised a swap sector
 };
 
 #endif // ADDRSPACE_H
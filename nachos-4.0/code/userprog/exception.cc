@@ -4,8 +4,7 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,8 +13,11 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
+// The file system calls keep a table of open files in each address
+// space (see AddrSpace::AddFile).  Their buffers are moved between 
+// user memory and the kernel a page at a time, translating each page
+// once (see AddrSpace::CopyIn).  Read and Write are just Readv and 
+// Writev with one buffer.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -23,7 +25,215 @@
 
 #include "copyright.h"
 #include "main.h"
-#include "syscall.h"
+#include "synchconsole.h"
+#include "syscall.h"		// after the console classes: it #defines
+				// ConsoleInput and ConsoleOutput
+
+#define MaxUserString	256	// longest string argument of a system call
+
+//----------------------------------------------------------------------
+// ReadConsole
+// 	Read up to "size" characters typed at the console into "into",
+//	stopping after the end of a line.  Wait for at least one.
+//	Return how many were read.
+//----------------------------------------------------------------------
+
+static int
+ReadConsole(char *into, int size)
+{
+    int n = 0;
+
+    if (kernel->synchConsoleIn == NULL)
+	kernel->synchConsoleIn = new SynchConsoleInput(NULL);
+    while (n < size) {
+	into[n] = kernel->synchConsoleIn->GetChar();
+	if (into[n++] == '\n')
+	    break;
+    }
+    return n;
+}
+
+//----------------------------------------------------------------------
+// WriteConsole
+// 	Write "size" characters from "from" to the console.
+//----------------------------------------------------------------------
+
+static void
+WriteConsole(char *from, int size)
+{
+    if (kernel->synchConsoleOut == NULL)
+	kernel->synchConsoleOut = new SynchConsoleOutput(NULL);
+    for (int i = 0; i < size; i++)
+	kernel->synchConsoleOut->PutChar(from[i]);
+}
+
+//----------------------------------------------------------------------
+// WriteFile
+// 	Write "size" bytes from "from" to "file", or to the console if
+//	"file" is NULL.  Return how many were written.
+//----------------------------------------------------------------------
+
+static int
+WriteFile(OpenFile *file, char *from, int size)
+{
+    if (file == NULL) {
+	WriteConsole(from, size);
+	return size;
+    }
+    return file->Write(from, size);
+}
+
+//----------------------------------------------------------------------
+// CheckIoVecs
+// 	Return TRUE if each of the "count" user buffers, at "addrs" and
+//	of "sizes" bytes, lies within the address space.
+//----------------------------------------------------------------------
+
+static bool
+CheckIoVecs(int *addrs, int *sizes, int count)
+{
+    unsigned int limit = kernel->currentThread->space->NumPages() * PageSize;
+
+    for (int i = 0; i < count; i++) {
+	if (addrs[i] < 0 || sizes[i] < 0 || 
+		(unsigned) addrs[i] + (unsigned) sizes[i] > limit)
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FetchIoVecs
+// 	Copy in the array of "count" IoVec's at user address "addr", in
+//	one go, into "addrs" and "sizes".  Return FALSE if there are too
+//	many, or the array or any of its buffers isn't in user memory.
+//----------------------------------------------------------------------
+
+static bool
+FetchIoVecs(int addr, int count, int *addrs, int *sizes)
+{
+    int vecs[2 * MaxIoVecs];
+
+    if (count < 0 || count > MaxIoVecs || !kernel->currentThread->space->
+		CopyIn(addr, (char *) vecs, count * 2 * sizeof(int)))
+	return FALSE;
+    for (int i = 0; i < count; i++) {
+	addrs[i] = WordToHost(vecs[2 * i]);
+	sizes[i] = WordToHost(vecs[2 * i + 1]);
+    }
+    return CheckIoVecs(addrs, sizes, count);
+}
+
+//----------------------------------------------------------------------
+// SysReadv
+// 	The Read and Readv system calls: read from open file "id" into
+//	"count" user buffers, filling each before going on to the next.
+//	The file is read a page's worth at a time into a kernel buffer,
+//	however small the user buffers, and each piece is scattered to
+//	them with CopyOut.  The console only gives up to the end of a
+//	line.  Return how many bytes were read, or -1 if "id" isn't open.
+//	The buffers have been checked, but a page may be unmapped under
+//	us; then we stop there and return what was delivered before it
+//	(-1 if that is nothing), although more may have been read.
+//----------------------------------------------------------------------
+
+static int
+SysReadv(int *addrs, int *sizes, int count, OpenFileId id)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    OpenFile *file = space->GetFile(id);
+    char buffer[PageSize];
+    int total = 0, done = 0, vec = 0, offset = 0;
+    int want, n, i, piece;
+
+    if (file == NULL && id != ConsoleInput)
+	return -1;
+    for (i = 0; i < count; i++)
+	total += sizes[i];
+    while (done < total) {
+	want = min(total - done, (int) PageSize);
+	if (file == NULL)
+	    n = ReadConsole(buffer, want);
+	else
+	    n = file->Read(buffer, want);
+	for (i = 0; i < n; i += piece) {	// scatter what we got
+	    while (offset == sizes[vec]) {
+		vec++;
+		offset = 0;
+	    }
+	    piece = min(n - i, sizes[vec] - offset);
+	    if (!space->CopyOut(&buffer[i], addrs[vec] + offset, piece))
+		return (done + i > 0) ? done + i : -1;
+	    offset += piece;
+	}
+	done += n;
+	if (n < want || (file == NULL && buffer[n - 1] == '\n'))
+	    break;			// end of the file, or of the line
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// SysWritev
+// 	The Write and Writev system calls: write "count" user buffers,
+//	one after another, to open file "id".  The buffers are gathered
+//	with CopyIn into a kernel buffer, and each time it fills up it
+//	is written to the file at once, so many small records cost one
+//	file system write per page's worth.  Return how many bytes were
+//	written, or -1 if "id" isn't open.  The buffers have been 
+//	checked, but a page may be unmapped under us; then we write what
+//	was gathered before it, and stop there (-1 if that is nothing).
+//----------------------------------------------------------------------
+
+static int
+SysWritev(int *addrs, int *sizes, int count, OpenFileId id)
+{
+    AddrSpace *space = kernel->currentThread->space;
+    OpenFile *file = space->GetFile(id);
+    char buffer[PageSize];
+    int done = 0, fill = 0, offset, piece, n;
+
+    if (file == NULL && id != ConsoleOutput)
+	return -1;
+    for (int i = 0; i < count; i++) {
+	for (offset = 0; offset < sizes[i]; offset += piece) {
+	    piece = min(sizes[i] - offset, (int) PageSize - fill);
+	    if (!space->CopyIn(addrs[i] + offset, &buffer[fill], piece)) {
+		if (fill > 0)
+		    done += WriteFile(file, buffer, fill);
+		return (done > 0) ? done : -1;
+	    }
+	    fill += piece;
+	    if (fill == PageSize) {
+		n = WriteFile(file, buffer, fill);
+		done += n;
+		if (n < fill)
+		    return done;	// no room left for the file
+		fill = 0;
+	    }
+	}
+    }
+    if (fill > 0)			// what's left over
+	done += WriteFile(file, buffer, fill);
+    return done;
+}
+
+//----------------------------------------------------------------------
+// ExitProcess
+// 	End the running user program.  Deleting its address space closes
+//	its files, writes back and unmaps its file mappings, detaches its
+//	shared segments and frees its memory; then the thread finishes.
+//----------------------------------------------------------------------
+
+static void
+ExitProcess()
+{
+    AddrSpace *space = kernel->currentThread->space;
+
+    kernel->currentThread->space = NULL;	// no user state to save
+    delete space;
+    kernel->currentThread->Finish();
+}
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -59,6 +269,12 @@ ExceptionHandler(ExceptionType which)
 	    switch(type) {
 		case SC_Halt:
 		    DEBUG(dbgAddr, "Shutdown, initiated by user program.\n");
+#ifdef FILESYS
+		    kernel->fileSystem->Sync();
+		    kernel->bufferCache->Flush();
+		    if (kernel->logDisk != NULL)
+			kernel->logDisk->Flush();
+#endif
    		    kernel->interrupt->Halt();
 		    break;
 		case SC_PrintInt:
@@ -70,6 +286,146 @@ ExceptionHandler(ExceptionType which)
 			//cout << "Sleep Time " << val << "(ms) " << endl;
 			kernel->alarm->WaitUntil(val);
 			return;
+		case SC_Sbrk:
+			val=kernel->machine->ReadRegister(4);
+			val=kernel->currentThread->space->Sbrk(val);
+			kernel->machine->WriteRegister(2, val);
+			return;
+		case SC_Mmap:
+			{
+			char name[MaxUserString];
+			val=kernel->machine->ReadRegister(4);
+			if (kernel->currentThread->space->CopyInString(val, name, MaxUserString))
+				val=kernel->currentThread->space->Mmap(name,
+					kernel->machine->ReadRegister(5));
+			else
+				val=-1;
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_Munmap:
+			val=kernel->machine->ReadRegister(4);
+			val=kernel->currentThread->space->Munmap(val);
+			kernel->machine->WriteRegister(2, val);
+			return;
+		case SC_ShmCreate:
+			{
+			char name[MaxUserString];
+			val=kernel->machine->ReadRegister(4);
+			if (kernel->currentThread->space->CopyInString(val, name, MaxUserString))
+				val=kernel->memoryManager->CreateSegment(name,
+					kernel->machine->ReadRegister(5));
+			else
+				val=-1;
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_ShmAttach:
+			{
+			char name[MaxUserString];
+			val=kernel->machine->ReadRegister(4);
+			if (kernel->currentThread->space->CopyInString(val, name, MaxUserString))
+				val=kernel->currentThread->space->ShmAttach(name);
+			else
+				val=-1;
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_ShmDetach:
+			val=kernel->machine->ReadRegister(4);
+			val=kernel->currentThread->space->ShmDetach(val);
+			kernel->machine->WriteRegister(2, val);
+			return;
+		case SC_Create:
+			{
+			char name[MaxUserString];
+			val=kernel->machine->ReadRegister(4);
+			if (!kernel->currentThread->space->CopyInString(val, name, MaxUserString))
+				val=-1;
+#ifdef FILESYS
+			else if (kernel->fileSystem->Create(name, 0))
+#else
+			else if (kernel->fileSystem->Create(name))
+#endif
+				val=1;
+			else
+				val=-1;
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_Mkdir:
+			{
+			char name[MaxUserString];
+			val=kernel->machine->ReadRegister(4);
+			if (kernel->currentThread->space->CopyInString(val, name, MaxUserString) &&
+			    kernel->fileSystem->Mkdir(name))
+				val=1;
+			else
+				val=-1;
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_Open:
+			{
+			char name[MaxUserString];
+			OpenFile *file = NULL;
+			val=kernel->machine->ReadRegister(4);
+			if (kernel->currentThread->space->CopyInString(val, name, MaxUserString))
+				file=kernel->fileSystem->Open(name);
+			val=-1;
+			if (file != NULL &&
+			    (val=kernel->currentThread->space->AddFile(file)) == -1)
+				delete file;		// too many open files
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_Read:
+		case SC_Write:
+			{
+			int addr=kernel->machine->ReadRegister(4);
+			int size=kernel->machine->ReadRegister(5);
+			val=kernel->machine->ReadRegister(6);
+			if (!CheckIoVecs(&addr, &size, 1))
+				val=-1;
+			else if (type == SC_Read)
+				val=SysReadv(&addr, &size, 1, val);
+			else
+				val=SysWritev(&addr, &size, 1, val);
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_Readv:
+		case SC_Writev:
+			{
+			int addrs[MaxIoVecs], sizes[MaxIoVecs];
+			int count=kernel->machine->ReadRegister(5);
+			val=kernel->machine->ReadRegister(6);
+			if (!FetchIoVecs(kernel->machine->ReadRegister(4), 
+					count, addrs, sizes))
+				val=-1;
+			else if (type == SC_Readv)
+				val=SysReadv(addrs, sizes, count, val);
+			else
+				val=SysWritev(addrs, sizes, count, val);
+			kernel->machine->WriteRegister(2, val);
+			}
+			return;
+		case SC_RingSetup:
+			val=kernel->machine->ReadRegister(4);
+			val=kernel->currentThread->space->SetupRing(val);
+			kernel->machine->WriteRegister(2, val);
+			return;
+		case SC_RingEnter:
+			val=kernel->currentThread->space->EnterRing(
+				kernel->machine->ReadRegister(4),
+				kernel->machine->ReadRegister(5));
+			kernel->machine->WriteRegister(2, val);
+			return;
+		case SC_Close:
+			val=kernel->machine->ReadRegister(4);
+			val=kernel->currentThread->space->CloseFile(val) ? 0 : -1;
+			kernel->machine->WriteRegister(2, val);
+			return;
 /*		case SC_Exec:
 			DEBUG(dbgAddr, "Exec\n");
 			val = kernel->machine->ReadRegister(4);
@@ -82,7 +438,7 @@ ExceptionHandler(ExceptionType which)
 			DEBUG(dbgAddr, "Program exit\n");
 			val=kernel->machine->ReadRegister(4);
 			cout << "return value:" << val << endl;
-			kernel->currentThread->Finish();
+			ExitProcess();
 			break;
 		default:
 		    cerr << "Unexpected system call " << type << "\n";
@@ -93,7 +449,10 @@ ExceptionHandler(ExceptionType which)
         // Memory management
         case PageFaultException:
             val = kernel -> machine -> ReadRegister(BadVAddrReg);
-            kernel -> memoryManager -> PageFaultHandler(val / PageSize);
+            if (!kernel -> memoryManager -> PageFaultHandler(val / PageSize)) {
+                cerr << "Access to unmapped address " << val << "\n";
+                ExitProcess();		// writes back its other mappings
+            }
             return;
 
 	default:
@@ -0,0 +1,295 @@
+// ioring.cc 
+//	Routines to manage the kernel's side of a ring of asynchronous
+//	requests.
+//
+//	A request costs no system call of its own: RingEnter takes all
+//	the ones queued, up to "toSubmit", and forks a worker thread for
+//	each.  The workers block in the file system, or the alarm, each
+//	on its own, so one user thread can keep many disk requests 
+//	going.  The completion queue is never overrun: a request is only
+//	taken if there will be room to post it, counting the completions
+//	posted but not yet consumed, and the requests in flight.  How far
+//	the program says it has consumed is its own to write, so we never
+//	believe it has more than RingSize completions, or fewer than none,
+//	waiting; so there are never more than RingSize workers.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "ioring.h"
+#include "synch.h"
+#include "main.h"
+#include "syscall.h"		// after the console classes: it #defines
+				// ConsoleInput and ConsoleOutput
+
+// Where the fields of a Ring (cf. syscall.h) are, in user memory.
+// Pointers are one word, as on the MIPS.
+
+#define SqHeadOffset		0
+#define SqTailOffset		4
+#define CqHeadOffset		8
+#define CqTailOffset		12
+#define SqOffset		16
+#define RequestBytes		(6 * 4)
+#define CqOffset		(SqOffset + RingSize * RequestBytes)
+#define CompletionBytes		(2 * 4)
+#define RingBytes		(CqOffset + RingSize * CompletionBytes)
+
+//----------------------------------------------------------------------
+// RingWorker
+// 	Run one request of a ring.  We can't Fork a member function, so 
+//	this is the procedure a worker thread starts in.
+//----------------------------------------------------------------------
+
+static void
+RingWorker(RingWork *work)
+{
+    work->ring->Perform(work);
+}
+
+//----------------------------------------------------------------------
+// IoRing::IoRing
+// 	Set up the kernel's side of the ring at "ringAddr" in "space",
+//	and empty both of its queues.  The caller has checked that the 
+//	ring is in writable user memory (see AddrSpace::SetupRing).
+//----------------------------------------------------------------------
+
+IoRing::IoRing(AddrSpace *addrSpace, int addr)
+{
+    space = addrSpace;
+    ringAddr = addr;
+    sqHead = cqTail = inFlight = 0;
+    lock = new Lock("ring lock");
+    posted = new Condition("ring posted");
+    WriteWord(SqHeadOffset, 0);
+    WriteWord(SqTailOffset, 0);
+    WriteWord(CqHeadOffset, 0);
+    WriteWord(CqTailOffset, 0);
+}
+
+//----------------------------------------------------------------------
+// IoRing::~IoRing
+// 	Wait for the requests in flight, and de-allocate the ring.
+//----------------------------------------------------------------------
+
+IoRing::~IoRing()
+{
+    Drain();
+    delete posted;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Size
+// 	Return how many bytes of user memory a ring takes.
+//----------------------------------------------------------------------
+
+int
+IoRing::Size()
+{
+    return RingBytes;
+}
+
+//----------------------------------------------------------------------
+// IoRing::ReadWord/WriteWord
+// 	Read/write the word at "offset" in the ring.
+//----------------------------------------------------------------------
+
+int
+IoRing::ReadWord(int offset)
+{
+    int word = 0;			// if the page was unmapped
+
+    space->CopyIn(ringAddr + offset, (char *) &word, sizeof(int));
+    return WordToHost(word);
+}
+
+//----------------------------------------------------------------------
+// IoRing::Unconsumed
+// 	Return how many completions are posted but not yet consumed,
+//	going by the head the program wrote -- but never fewer than 0
+//	or more than RingSize, whatever it wrote.
+//----------------------------------------------------------------------
+
+int
+IoRing::Unconsumed()
+{
+    int count = cqTail - ReadWord(CqHeadOffset);
+
+    return max(0, min(count, RingSize));
+}
+
+void
+IoRing::WriteWord(int offset, int value)
+{
+    int word = WordToHost(value);
+
+    space->CopyOut((char *) &word, ringAddr + offset, sizeof(int));
+}
+
+//----------------------------------------------------------------------
+// IoRing::Enter
+// 	Take up to "toSubmit" requests off the ring, and start each one.
+//	Then wait until at least "minComplete" completions are posted
+//	and not yet consumed, unless nothing is left in flight to post
+//	them.  Return how many requests were taken.
+//----------------------------------------------------------------------
+
+int
+IoRing::Enter(int toSubmit, int minComplete)
+{
+    RingWork *work;
+    int sqTail, request, taken = 0;
+
+    lock->Acquire();
+    sqTail = ReadWord(SqTailOffset);
+    while (taken < toSubmit && sqHead != sqTail && 
+		inFlight + Unconsumed() < RingSize) {
+	request = SqOffset + (sqHead % RingSize) * RequestBytes;
+	work = new RingWork;
+	work->ring = this;
+	work->op = ReadWord(request);
+	work->id = ReadWord(request + 4);
+	work->buffer = ReadWord(request + 8);
+	work->size = ReadWord(request + 12);
+	work->offset = ReadWord(request + 16);
+	work->userData = ReadWord(request + 20);
+	sqHead++;
+	taken++;
+
+	if (!Check(work) || work->op == RingNop) {
+	    Post(work->userData, (work->op == RingNop) ? 0 : -1);
+	    delete work;
+	} else {
+	    Thread *t = new Thread("ring worker");
+
+	    t->space = space;		// so it can fault in user pages
+	    inFlight++;
+	    t->Fork((VoidFunctionPtr) RingWorker, (void *) work);
+	}
+    }
+    WriteWord(SqHeadOffset, sqHead);
+    DEBUG(dbgAddr, "Ring took " << taken << " requests, " << inFlight << " in flight");
+
+    while (inFlight > 0 && Unconsumed() < minComplete)
+	posted->Wait(lock);
+    lock->Release();
+    return taken;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Drain
+// 	Wait until every request taken has been posted.  A file can't 
+//	be closed while a worker may be using it.
+//----------------------------------------------------------------------
+
+void
+IoRing::Drain()
+{
+    lock->Acquire();
+    while (inFlight > 0)
+	posted->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// IoRing::Check
+// 	Return TRUE if "work" can be carried out: a known operation, on
+//	a file that is open, with its buffer all in user memory.
+//----------------------------------------------------------------------
+
+bool
+IoRing::Check(RingWork *work)
+{
+    unsigned int limit = space->NumPages() * PageSize;
+
+    switch (work->op) {
+      case RingNop:
+      case RingSleep:
+	return work->size >= 0;
+      case RingRead:
+      case RingWrite:
+	return space->GetFile(work->id) != NULL && work->size >= 0 &&
+		work->offset >= 0 && work->buffer >= 0 && 
+		(unsigned) work->buffer + (unsigned) work->size <= limit;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// IoRing::Perform
+// 	Carry out a request, in a worker thread of its own, and post its
+//	completion.  File data moves through a kernel buffer a page at a
+//	time, as for Read and Write.
+//----------------------------------------------------------------------
+
+void
+IoRing::Perform(RingWork *work)
+{
+    OpenFile *file = space->GetFile(work->id);
+    char buffer[PageSize];
+    int result = 0, count, n;
+
+    space->RestoreState();		// a new thread: the machine still
+					// has whichever space ran last
+    switch (work->op) {
+      case RingSleep:
+	kernel->alarm->WaitUntil(work->size);
+	break;
+      case RingRead:
+	while (result < work->size) {
+	    count = min(work->size - result, (int) PageSize);
+	    n = file->ReadAt(buffer, count, work->offset + result);
+	    if (n > 0 && !space->CopyOut(buffer, work->buffer + result, n)) {
+		result = -1;		// read-only page
+		break;
+	    }
+	    result += n;
+	    if (n < count)
+		break;			// end of the file
+	}
+	break;
+      case RingWrite:
+	while (result < work->size) {
+	    count = min(work->size - result, (int) PageSize);
+	    if (!space->CopyIn(work->buffer + result, buffer, count)) {
+		if (result == 0)
+		    result = -1;	// unmapped page
+		break;
+	    }
+	    n = file->WriteAt(buffer, count, work->offset + result);
+	    result += n;
+	    if (n < count)
+		break;			// no room left for the file
+	}
+	break;
+    }
+
+    lock->Acquire();
+    Post(work->userData, result);
+    kernel->currentThread->space = NULL;	// once nothing is in flight,
+    inFlight--;				// the space can be deleted
+    lock->Release();
+    delete work;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Post
+// 	Post a completion to the ring, and wake anyone waiting for one.
+//	The caller holds the lock, and has made sure there is room.
+//----------------------------------------------------------------------
+
+void
+IoRing::Post(int userData, int result)
+{
+    int completion = CqOffset + (cqTail % RingSize) * CompletionBytes;
+
+    WriteWord(completion, userData);
+    WriteWord(completion + 4, result);
+    cqTail++;
+    WriteWord(CqTailOffset, cqTail);	// only now can the program see it
+    posted->Broadcast(lock);
+}
@@ -0,0 +1,81 @@
+// ioring.h 
+//	Data structures for a ring of asynchronous requests shared by a
+//	user program and the kernel (cf. RingSetup in syscall.h).
+//
+//	The ring itself lives in the program's memory, where both sides
+//	can see it; the kernel reads and writes it with CopyIn/CopyOut,
+//	so its pages can come and go like any others.  The kernel keeps
+//	its own copy of the indices it owns -- the head of the request
+//	queue, and the tail of the completion queue -- and never trusts
+//	the program's.
+//
+//	RingEnter takes requests off the queue and forks a kernel thread
+//	for each one.  The thread runs in the program's address space, 
+//	so it can fault in the pages it touches, and posts the completion
+//	to the ring itself, as soon as it is done.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IORING_H
+#define IORING_H
+
+#include "copyright.h"
+
+class AddrSpace;
+class Lock;
+class Condition;
+class IoRing;
+
+// One request in flight, copied out of the ring.
+
+class RingWork {
+  public:
+    IoRing *ring;			// the ring it came from
+    int op;				// RingRead, RingWrite, ...
+    int id;				// OpenFileId
+    int buffer;				// user address of the data
+    int size;				// bytes, or ticks for RingSleep
+    int offset;				// where in the file
+    int userData;			// handed back in the completion
+};
+
+// The following class defines the kernel's side of a ring.
+
+class IoRing {
+  public:
+    IoRing(AddrSpace *space, int ringAddr);
+					// The ring at "ringAddr" in "space";
+					// it is emptied
+    ~IoRing();				// Wait for requests in flight, 
+					// then de-allocate
+
+    int Enter(int toSubmit, int minComplete);
+					// Submit requests, and wait for 
+					// completions
+    void Drain();			// Wait until nothing is in flight
+
+    void Perform(RingWork *work);	// Body of a worker thread
+
+    static int Size();			// Bytes of user memory a ring takes
+
+  private:
+    AddrSpace *space;			// where the ring is
+    int ringAddr;			// its user address
+    int sqHead;				// next request to take
+    int cqTail;				// next completion to post
+    int inFlight;			// requests taken, not yet posted
+    Lock *lock;				// protects all of the above
+    Condition *posted;			// signalled with each completion
+
+    int ReadWord(int offset);		// Read/write a word of the ring
+    void WriteWord(int offset, int value);
+    int Unconsumed();			// Completions the program has yet
+					// to consume, 0 .. RingSize
+    bool Check(RingWork *work);		// Does the request make sense?
+    void Post(int userData, int result);
+					// Post a completion
+};
+
+#endif // IORING_H
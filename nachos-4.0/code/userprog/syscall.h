@@ -31,6 +31,27 @@
 #define SC_ThreadYield	10
 #define SC_PrintInt	11
 #define SC_Sleep        12
+#define SC_Sbrk		13
+#define SC_Mmap		14
+#define SC_Munmap	15
+#define SC_ShmCreate	16
+#define SC_ShmAttach	17
+#define SC_ShmDetach	18
+#define SC_Readv	19
+#define SC_Writev	20
+#define SC_RingSetup	21
+#define SC_RingEnter	22
+#define SC_Mkdir	23
+
+#define MaxIoVecs	16	/* most buffers in one Readv/Writev */
+
+#define RingSize	32	/* entries in each queue of a Ring */
+
+/* what a RingRequest asks for */
+#define RingNop		0
+#define RingRead	1
+#define RingWrite	2
+#define RingSleep	3
 
 #ifndef IN_ASM
 
@@ -88,16 +109,29 @@ typedef int OpenFileId;
 #define ConsoleInput	0  
 #define ConsoleOutput	1  
  
-/* Create a Nachos file, with "name" */
-void Create(char *name);
+/* Create a Nachos file, with "name".  Return 1 on success, or -1 if
+ * the name is bad or the file can't be created (it exists already, or
+ * there is no room).
+ */
+int Create(char *name);
+
+/* Create an empty directory "name".  Return 1 on success, or -1 if
+ * it can't be created (the name exists already, a directory on the
+ * way to it doesn't, or there is no room).  With the real file system
+ * names are paths, like "/dir/sub/file", wherever a name is taken.
+ */
+int Mkdir(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
  * be used to read and write to the file.
  */
 OpenFileId Open(char *name);
 
-/* Write "size" bytes from "buffer" to the open file. */
-void Write(char *buffer, int size, OpenFileId id);
+/* Write "size" bytes from "buffer" to the open file.  Return the
+ * number of bytes actually written -- fewer if the disk fills up -- 
+ * or -1 if the file isn't open or "buffer" can't be read.
+ */
+int Write(char *buffer, int size, OpenFileId id);
 
 /* Read "size" bytes from the open file into "buffer".  
  * Return the number of bytes actually read -- if the open file isn't
@@ -110,6 +144,70 @@ int Read(char *buffer, int size, OpenFileId id);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Vectored I/O.  Readv reads from the open file into each of the 
+ * "count" buffers of "iov" in turn, and Writev writes each of them in 
+ * turn, all in one system call -- so a program with many small records
+ * to move needn't trap to the kernel for each.  At most MaxIoVecs 
+ * buffers.  Both return the number of bytes moved, or -1 on an error 
+ * (as Read does, Readv stops short at the end of the file, or of a 
+ * line typed at the console).
+ */
+typedef struct IoVec {
+    char *buffer;
+    int size;
+} IoVec;
+
+int Readv(IoVec *iov, int count, OpenFileId id);
+int Writev(IoVec *iov, int count, OpenFileId id);
+
+/* Asynchronous requests.  A Ring in the program's memory holds a queue
+ * of requests for the kernel, and a queue of their completions.  The
+ * program fills in sq[sqTail % RingSize] and increments sqTail for each
+ * request; RingEnter hands up to "toSubmit" of them to the kernel at 
+ * once (advancing sqHead), and returns how many it took.  Each request
+ * is carried out by a kernel thread of its own, so that many can be 
+ * waiting for the disk (or the alarm) at the same time; when one is 
+ * done, its completion appears at cq[cqTail % RingSize], and cqTail is
+ * incremented, without the program having to ask.  The program 
+ * consumes completions by incrementing cqHead.
+ *
+ * RingEnter also waits until at least "minComplete" completions are 
+ * there to consume (or until nothing is left in flight).  The kernel
+ * takes no more requests than there is room for their completions.
+ *
+ * RingRead and RingWrite move "size" bytes between "buffer" and the 
+ * open file "id", at byte "offset" in the file; the result is the 
+ * number of bytes moved.  RingSleep waits "size" ticks of the alarm.
+ * A request that makes no sense completes at once with result -1.
+ * Closing a file waits for every request in flight.
+ *
+ * RingSetup registers the ring (once per address space); it returns 0,
+ * or -1 if "ring" isn't writable memory, or there is a ring already.
+ */
+typedef struct RingRequest {
+    int op;			/* RingRead, RingWrite, ... */
+    OpenFileId id;
+    char *buffer;
+    int size;
+    int offset;
+    int userData;		/* handed back in the completion */
+} RingRequest;
+
+typedef struct RingCompletion {
+    int userData;
+    int result;
+} RingCompletion;
+
+typedef struct Ring {
+    int sqHead, sqTail;		/* requests */
+    int cqHead, cqTail;		/* completions */
+    RingRequest sq[RingSize];
+    RingCompletion cq[RingSize];
+} Ring;
+
+int RingSetup(Ring *ring);
+int RingEnter(int toSubmit, int minComplete);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -130,6 +228,40 @@ void ThreadYield();
 
 void PrintInt(int number);	//my System Call
 void Sleep(int number);
+
+/* Grow the heap of the address space by "increment" bytes, and return 
+ * the address of the start of the new memory (the old end of the heap),
+ * or -1 if the address space can't grow that much.  New memory reads
+ * as zero.  See test/malloc.c for an allocator built on top of this.
+ */
+int Sbrk(int increment);
+
+/* Map the first "length" bytes of the Nachos file "name" into the 
+ * address space (all of it, if "length" is 0 or more than the file
+ * holds), and return the address of the mapping, or -1 on failure.  
+ * Pages are read from the file when first touched; modified pages are
+ * written back to the file when they are evicted or unmapped, or the 
+ * program exits.  The file is never extended.
+ */
+int Mmap(char *name, int length);
+
+/* Remove the mapping returned by Mmap at "addr", writing back any
+ * modified pages.  Returns 0, or -1 if nothing is mapped there.
+ */
+int Munmap(int addr);
+
+/* Shared memory.  ShmCreate makes a new shared segment of "size" bytes
+ * (initially zero) called "name", and returns 0, or -1 if the name is
+ * taken.  ShmAttach maps the segment into the address space of the 
+ * caller and returns its address, or -1 if there is no such segment; 
+ * every process attaching the same segment sees the same memory.  
+ * ShmDetach removes the segment attached at "addr" and returns 0, or 
+ * -1 if there is none.  A segment is destroyed when the last process
+ * attaching it detaches.
+ */
+int ShmCreate(char *name, int size);
+int ShmAttach(char *name);
+int ShmDetach(int addr);
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -21,6 +21,13 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 		: ThreadedKernel(argc, argv)
 {
     debugUserProg = FALSE;
+    pagingStatFile = NULL;
+#ifdef FILESYS
+    bufferCacheSize = DefaultCacheSize;
+    formatDisk = FALSE;
+    logStructured = FALSE;
+    fileSystemTest = FALSE;
+#endif
 	execfileNum=0;
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-s") == 0) {
@@ -34,6 +41,17 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
 		cout << "Partial usage: nachos [-s]\n";
 		cout << "Partial usage: nachos [-u]" << endl;
 		cout << "Partial usage: nachos [-e] filename" << endl;
+		cout << "Partial usage: nachos [-vic random|lru|lfu]" << endl;
+		cout << "Partial usage: nachos [-pstat file.csv|file.json]" << endl;
+		cout << "Partial usage: nachos [-pt linear|2level]" << endl;
+		cout << "Partial usage: nachos [-ds fcfs|sstf|scan|clook]" << endl;
+		cout << "Partial usage: nachos [-fsync never|close|always]" << endl;
+#ifdef FILESYS
+		cout << "Partial usage: nachos [-bc] buffers" << endl;
+		cout << "Partial usage: nachos [-f]" << endl;
+		cout << "Partial usage: nachos [-lfs]" << endl;
+		cout << "Partial usage: nachos [-t]" << endl;
+#endif
 	}
 	else if (strcmp(argv[i], "-h") == 0) {
 		cout << "argument 's' is for debugging. Machine status  will be printed " << endl;
@@ -59,6 +77,53 @@ UserProgKernel::UserProgKernel(int argc, char **argv)
                 vicType = Random;
             }
         }
+        else if (strcmp(argv[i], "-pt") == 0){
+            ASSERT(i + 1 < argc); // next argument is the page table layout
+            AddrSpace::multiLevel = (strcmp(argv[++i], "2level") == 0);
+        }
+        else if (strcmp(argv[i], "-pstat") == 0){
+            ASSERT(i + 1 < argc); // next argument is the dump file
+            pagingStatFile = argv[++i];
+        }
+        else if (strcmp(argv[i], "-ds") == 0){
+            ASSERT(i + 1 < argc); // next argument is the disk scheduler
+            char *dsArg = argv[++i];
+            if(strcmp(dsArg, "sstf") == 0)
+                AsyncDisk::policy = DiskSSTF;
+            else if(strcmp(dsArg, "scan") == 0)
+                AsyncDisk::policy = DiskSCAN;
+            else if(strcmp(dsArg, "clook") == 0)
+                AsyncDisk::policy = DiskCLOOK;
+            else
+                AsyncDisk::policy = DiskFCFS;
+        }
+        else if (strcmp(argv[i], "-fsync") == 0){
+            ASSERT(i + 1 < argc); // next argument is the fsync policy
+            char *syncArg = argv[++i];
+            if(strcmp(syncArg, "always") == 0)
+                Disk::syncPolicy = SyncAlways;
+            else if(strcmp(syncArg, "close") == 0)
+                Disk::syncPolicy = SyncOnClose;
+            else
+                Disk::syncPolicy = SyncNever;
+        }
+#ifdef FILESYS
+        else if (strcmp(argv[i], "-bc") == 0){
+            ASSERT(i + 1 < argc); // next argument is the cache size
+            bufferCacheSize = atoi(argv[++i]);
+            ASSERT(bufferCacheSize >= 0);
+        }
+        else if (strcmp(argv[i], "-f") == 0){
+            formatDisk = TRUE;
+        }
+        else if (strcmp(argv[i], "-lfs") == 0){
+            formatDisk = TRUE;		// a new disk, log-structured
+            logStructured = TRUE;
+        }
+        else if (strcmp(argv[i], "-t") == 0){
+            fileSystemTest = TRUE;
+        }
+#endif
     }
 }
 
@@ -77,6 +142,11 @@ UserProgKernel::Initialize(SchedulerType type)
 {
     ThreadedKernel::Initialize(type);	// init multithreading
     machine = new Machine(debugUserProg);
+    // the console is opened the first time a user program reads or
+    // writes it: once open, the keyboard is polled for good
+    synchConsoleIn = NULL;
+    synchConsoleOut = NULL;
+    stats->pagingDumpFile = pagingStatFile;
 
     // Memory management
     swap = new SynchDisk("SWAPSPACE");
@@ -87,8 +157,8 @@ UserProgKernel::Initialize(SchedulerType type)
         frameTable[i].addrspace = NULL;
         frameTable[i].vpn = 0;
     }
-    swapTable = new FrameInfoEntry[1024];
-    for(int i = 0; i < 1024; i++){
+    swapTable = new FrameInfoEntry[NumSwapPages];
+    for(int i = 0; i < NumSwapPages; i++){
         swapTable[i].valid = true;
         swapTable[i].lock = false;
         swapTable[i].addrspace = NULL;
@@ -96,9 +166,24 @@ UserProgKernel::Initialize(SchedulerType type)
     }
     memoryManager = new MemoryManager(vicType);
 
-    fileSystem = new FileSystem();
 #ifdef FILESYS
+    // the file system reads the disk as it starts, so these come first
     synchDisk = new SynchDisk("New SynchDisk");
+    logDisk = new LogDisk(synchDisk->asyncDisk);
+    if (logStructured)
+	logDisk->Format();
+    else if (formatDisk || !logDisk->Mount()) {
+	delete logDisk;			// an ordinary disk
+	logDisk = NULL;
+    }
+    synchDisk->logDisk = logDisk;
+    bufferCache = new BufferCache(synchDisk, bufferCacheSize);
+    headerCache = new HeaderCache;
+    // the journal pins what it logs, so it gets half the cache at most
+    journal = new Journal(synchDisk, bufferCacheSize / 2);
+    fileSystem = new FileSystem(formatDisk);
+#else
+    fileSystem = new FileSystem();
 #endif // FILESYS
 }
 
@@ -111,8 +196,18 @@ UserProgKernel::Initialize(SchedulerType type)
 UserProgKernel::~UserProgKernel()
 {
     delete fileSystem;
+    if (synchConsoleIn != NULL)
+	delete synchConsoleIn;
+    if (synchConsoleOut != NULL)
+	delete synchConsoleOut;
     delete machine;
+    delete swap;
 #ifdef FILESYS
+    delete headerCache;
+    delete journal;			// after the last header write
+    delete bufferCache;
+    if (logDisk != NULL)
+	delete logDisk;
     delete synchDisk;
 #endif
 }
@@ -185,6 +280,14 @@ UserProgKernel::SelfTest() {
     // self test for running user programs is to run the halt program above
 */
 
+#ifdef FILESYS
+    if (fileSystemTest) {
+	Journal::SelfTest();
+	LogDisk::SelfTest();
+	fileSystem->SelfTest();
+	cout << "File system self-tests passed\n";
+    }
+#endif // FILESYS
 
 
 
@@ -16,11 +16,19 @@
 #include "filesys.h"
 #include "machine.h"
 #include "synchdisk.h"
+#ifdef FILESYS
+#include "bufcache.h"
+#include "hdrcache.h"
+#include "journal.h"
+#include "logdisk.h"
+#endif
 
 #include "addrspace.h" // memory management
 
 
 class SynchDisk;
+class SynchConsoleInput;
+class SynchConsoleOutput;
 class UserProgKernel : public ThreadedKernel {
   public:
     UserProgKernel(int argc, char **argv);
@@ -37,6 +45,8 @@ class UserProgKernel : public ThreadedKernel {
 // These are public for notational convenience.
     Machine *machine;
     FileSystem *fileSystem;
+    SynchConsoleInput *synchConsoleIn;	// the console, for user programs;
+    SynchConsoleOutput *synchConsoleOut;// each is NULL until first used
 
     // memorymanagement
     SynchDisk *swap;
@@ -44,10 +54,19 @@ class UserProgKernel : public ThreadedKernel {
     FrameInfoEntry *swapTable;
     MemoryManager *memoryManager;
     VictimType vicType;
+    char *pagingStatFile;	// where to dump paging statistics, or NULL
     // int faultPageNum;
 
 #ifdef FILESYS
     SynchDisk *synchDisk;
+    LogDisk *logDisk;		// NULL unless the disk is log-structured
+    BufferCache *bufferCache;	// all file system disk I/O goes here
+    HeaderCache *headerCache;	// file headers of the open files
+    Journal *journal;		// makes metadata changes crash-safe
+    int bufferCacheSize;	// buffers in the cache ("-bc")
+    bool formatDisk;		// start with an empty disk ("-f")
+    bool logStructured;		// ... laid out as a log ("-lfs")
+    bool fileSystemTest;	// run the file system self-tests ("-t")
 #endif // FILESYS
 
   private: